@@ -0,0 +1,345 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/sketch_config.h"
+#include "any_sketch/sketch_proto_conversion.h"
+#include "benchmark/benchmark.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/text_format.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+namespace {
+
+// HyperLogLog: a bucket and the rank of the fingerprint within the bucket.
+constexpr absl::string_view kHyperLogLogConfig = R"pb(
+  indexes {
+    name: "Bucket"
+    distribution { uniform { num_values: 16384 salt: "bucket" } }
+  }
+  indexes {
+    name: "Rank"
+    distribution {
+      geometric { success_probability: 0.5 num_values: 64 salt: "rank" }
+    }
+  }
+  values {
+    name: "Count"
+    aggregator: SUM
+    distribution { constant { value: 1 } }
+  }
+)pb";
+
+// Liquid Legions: exponentially distributed legionaries with a sampling
+// indicator and a frequency.
+constexpr absl::string_view kLiquidLegionsConfig = R"pb(
+  indexes {
+    name: "Index"
+    distribution {
+      exponential { rate: 12 num_values: 100000 salt: "index" }
+    }
+  }
+  values {
+    name: "SamplingIndicator"
+    aggregator: UNIQUE
+    distribution { uniform { num_values: 10000000 salt: "sampling" } }
+  }
+  values {
+    name: "Frequency"
+    aggregator: SUM
+    distribution { constant { value: 1 } }
+  }
+)pb";
+
+// Counting Bloom filter over 10M buckets.
+constexpr absl::string_view kCountingBloomFilterConfig = R"pb(
+  indexes {
+    name: "Index"
+    distribution { uniform { num_values: 10000000 } }
+  }
+  values {
+    name: "Count"
+    aggregator: SUM
+    distribution { constant { value: 1 } }
+  }
+)pb";
+
+// Counts the bytes written to it, discarding them.
+class CountingOutputStream : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  bool Next(void** data, int* size) override {
+    *data = buffer_.data();
+    *size = buffer_.size();
+    byte_count_ += buffer_.size();
+    return true;
+  }
+
+  void BackUp(int count) override { byte_count_ -= count; }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+ private:
+  std::array<char, 1 << 16> buffer_;
+  int64_t byte_count_ = 0;
+};
+
+// Reports the size of the serialized registers of `sketch` per register.
+void ReportBytesPerRegister(benchmark::State& state, const AnySketch& sketch) {
+  CountingOutputStream output;
+  if (absl::Status status = WriteSketchProto(sketch, &output); !status.ok()) {
+    state.SkipWithError(status.ToString().c_str());
+    return;
+  }
+  const size_t num_registers = sketch.num_registers();
+  state.counters["bytes_per_register"] =
+      num_registers == 0
+          ? 0
+          : static_cast<double>(output.ByteCount()) / num_registers;
+}
+
+std::unique_ptr<AnySketch> CreateSketch(benchmark::State& state,
+                                        absl::string_view config_text,
+                                        const AnySketchOptions& options = {}) {
+  SketchConfig config;
+  if (!google::protobuf::TextFormat::ParseFromString(std::string(config_text),
+                                                     &config)) {
+    state.SkipWithError("Invalid SketchConfig");
+    return nullptr;
+  }
+  absl::StatusOr<std::unique_ptr<AnySketch>> sketch =
+      CreateAnySketchFromConfig(config, options);
+  if (!sketch.ok()) {
+    state.SkipWithError(sketch.status().ToString().c_str());
+    return nullptr;
+  }
+  return *std::move(sketch);
+}
+
+void BM_InsertUint64(benchmark::State& state, absl::string_view config) {
+  std::unique_ptr<AnySketch> sketch = CreateSketch(state, config);
+  if (sketch == nullptr) return;
+  uint64_t item = 0;
+  for (auto _ : state) {
+    if (absl::Status status = sketch->Insert(item++, {}); !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  ReportBytesPerRegister(state, *sketch);
+}
+
+// Items are 16 bytes: a fixed prefix followed by a counter.
+void BM_InsertString(benchmark::State& state, absl::string_view config) {
+  std::unique_ptr<AnySketch> sketch = CreateSketch(state, config);
+  if (sketch == nullptr) return;
+  std::array<char, 16> buffer = {'i', 't', 'e', 'm', '-'};
+  const absl::string_view item(buffer.data(), buffer.size());
+  uint64_t counter = 0;
+  for (auto _ : state) {
+    std::memcpy(buffer.data() + 8, &counter, sizeof(counter));
+    ++counter;
+    if (absl::Status status = sketch->Insert(item, {}); !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+  ReportBytesPerRegister(state, *sketch);
+}
+
+void BM_InsertSpan(benchmark::State& state, absl::string_view config) {
+  std::unique_ptr<AnySketch> sketch = CreateSketch(state, config);
+  if (sketch == nullptr) return;
+  std::array<unsigned char, 16> buffer = {'i', 't', 'e', 'm', '-'};
+  uint64_t counter = 0;
+  for (auto _ : state) {
+    std::memcpy(buffer.data() + 8, &counter, sizeof(counter));
+    ++counter;
+    if (absl::Status status = sketch->Insert(buffer, {}); !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+  ReportBytesPerRegister(state, *sketch);
+}
+
+// Inserts batches of state.range(0) uint64 items.
+void BM_InsertBatchUint64(benchmark::State& state, absl::string_view config) {
+  std::unique_ptr<AnySketch> sketch = CreateSketch(state, config);
+  if (sketch == nullptr) return;
+  std::vector<uint64_t> items(state.range(0));
+  uint64_t item = 0;
+  for (auto _ : state) {
+    for (uint64_t& batch_item : items) {
+      batch_item = item++;
+    }
+    if (absl::Status status = sketch->InsertBatch(items); !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * items.size());
+  ReportBytesPerRegister(state, *sketch);
+}
+
+#define BENCHMARK_SKETCH_CONFIGS(benchmark_function)                        \
+  BENCHMARK_CAPTURE(benchmark_function, hyper_log_log, kHyperLogLogConfig); \
+  BENCHMARK_CAPTURE(benchmark_function, liquid_legions,                     \
+                    kLiquidLegionsConfig);                                  \
+  BENCHMARK_CAPTURE(benchmark_function, counting_bloom_filter,              \
+                    kCountingBloomFilterConfig)
+
+BENCHMARK_SKETCH_CONFIGS(BM_InsertUint64);
+BENCHMARK_SKETCH_CONFIGS(BM_InsertString);
+BENCHMARK_SKETCH_CONFIGS(BM_InsertSpan);
+BENCHMARK_CAPTURE(BM_InsertBatchUint64, hyper_log_log, kHyperLogLogConfig)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_InsertBatchUint64, liquid_legions, kLiquidLegionsConfig)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16);
+BENCHMARK_CAPTURE(BM_InsertBatchUint64, counting_bloom_filter,
+                  kCountingBloomFilterConfig)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16);
+
+// Returns a sketch over a single index of `num_registers` values with a SUM
+// value, in which every register is set.
+std::unique_ptr<AnySketch> CreateFullSketch(benchmark::State& state,
+                                            int64_t num_registers,
+                                            bool dense) {
+  const std::string config = absl::StrCat(
+      "indexes { distribution { uniform { num_values: ", num_registers,
+      " } } } values { aggregator: SUM distribution { constant { value: 1 } "
+      "} }");
+  AnySketchOptions options;
+  options.max_dense_index_space = dense ? num_registers : 0;
+  std::unique_ptr<AnySketch> sketch = CreateSketch(state, config, options);
+  if (sketch == nullptr) return nullptr;
+  const int64_t value = 1;
+  for (int64_t index = 0; index < num_registers; ++index) {
+    if (absl::Status status = sketch->AggregateIntoRegister(
+            index, absl::MakeConstSpan(&value, 1));
+        !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      return nullptr;
+    }
+  }
+  return sketch;
+}
+
+// Sparse sketches take tens of bytes per register, so only dense sketches are
+// benchmarked with 1e8 registers.
+void MergeArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"registers", "dense"});
+  for (int64_t num_registers : {10'000, 1'000'000, 100'000'000}) {
+    benchmark->Args({num_registers, 1});
+  }
+  for (int64_t num_registers : {10'000, 1'000'000}) {
+    benchmark->Args({num_registers, 0});
+  }
+}
+
+// Merges a sketch into one with the same registers.
+void BM_Merge(benchmark::State& state) {
+  const int64_t num_registers = state.range(0);
+  const bool dense = state.range(1) != 0;
+  std::unique_ptr<AnySketch> sketch =
+      CreateFullSketch(state, num_registers, dense);
+  std::unique_ptr<AnySketch> other =
+      CreateFullSketch(state, num_registers, dense);
+  if (sketch == nullptr || other == nullptr) return;
+  for (auto _ : state) {
+    if (absl::Status status = sketch->Merge(*other); !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_registers);
+  ReportBytesPerRegister(state, *sketch);
+}
+BENCHMARK(BM_Merge)->Apply(MergeArguments)->Unit(benchmark::kMillisecond);
+
+// Merges four sketches, with state.range(2) threads, into one with the same
+// registers. Five sketches are held at once, so this stops at 1e6 registers.
+// Sparse sketches are also merged with 2 and 8 threads, as each thread only
+// visits the registers of its own shard. The merge runs on worker threads, so
+// it is timed by the wall clock.
+void BM_MergeAll(benchmark::State& state) {
+  constexpr int kNumOthers = 4;
+  const int64_t num_registers = state.range(0);
+  const bool dense = state.range(1) != 0;
+  const int num_threads = state.range(2);
+  std::unique_ptr<AnySketch> sketch =
+      CreateFullSketch(state, num_registers, dense);
+  std::vector<std::unique_ptr<AnySketch>> others;
+  for (int i = 0; i < kNumOthers; ++i) {
+    others.push_back(CreateFullSketch(state, num_registers, dense));
+    if (others.back() == nullptr) return;
+  }
+  if (sketch == nullptr) return;
+  for (auto _ : state) {
+    if (absl::Status status = sketch->MergeAll(others, num_threads);
+        !status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumOthers * num_registers);
+  ReportBytesPerRegister(state, *sketch);
+}
+BENCHMARK(BM_MergeAll)
+    ->ArgNames({"registers", "dense", "threads"})
+    ->ArgsProduct({{10'000, 1'000'000}, {0, 1}, {1, 4}})
+    ->Args({1'000'000, 0, 2})
+    ->Args({1'000'000, 0, 8})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+void BM_Iterate(benchmark::State& state) {
+  const int64_t num_registers = state.range(0);
+  const bool dense = state.range(1) != 0;
+  std::unique_ptr<AnySketch> sketch =
+      CreateFullSketch(state, num_registers, dense);
+  if (sketch == nullptr) return;
+  for (auto _ : state) {
+    for (AnySketch::Register sketch_register : *sketch) {
+      benchmark::DoNotOptimize(sketch_register);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_registers);
+  ReportBytesPerRegister(state, *sketch);
+}
+BENCHMARK(BM_Iterate)->Apply(MergeArguments)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace wfa::any_sketch
@@ -0,0 +1,81 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "any_sketch/crypto/sketch_encrypter.h"
+#include "benchmark/benchmark.h"
+#include "common_cpp/macros/macros.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/context.h"
+#include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
+#include "wfa/any_sketch/crypto/el_gamal_key.pb.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+using ::private_join_and_compute::Context;
+using ::private_join_and_compute::ECGroup;
+using ::private_join_and_compute::ECPoint;
+
+constexpr int kCurveId = NID_X9_62_prime256v1;
+
+// Returns num_keys public keys with the same generator, made by hashing
+// strings to the curve.
+absl::StatusOr<std::vector<ElGamalPublicKey>> CreateKeys(int num_keys) {
+  Context ctx;
+  ASSIGN_OR_RETURN(ECGroup ec_group, ECGroup::Create(kCurveId, &ctx));
+  ASSIGN_OR_RETURN(ECPoint generator,
+                   ec_group.GetPointByHashingToCurveSha256("generator"));
+  ASSIGN_OR_RETURN(std::string generator_bytes,
+                   generator.ToBytesCompressed());
+  std::vector<ElGamalPublicKey> keys(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    ASSIGN_OR_RETURN(ECPoint element, ec_group.GetPointByHashingToCurveSha256(
+                                          absl::StrCat("key ", i)));
+    keys[i].set_generator(generator_bytes);
+    ASSIGN_OR_RETURN(*keys[i].mutable_element(), element.ToBytesCompressed());
+  }
+  return keys;
+}
+
+// Combines state.range(0) keys with state.range(1) threads.
+void BM_CombineElGamalPublicKeys(benchmark::State& state) {
+  const int num_keys = state.range(0);
+  const int num_threads = state.range(1);
+  absl::StatusOr<std::vector<ElGamalPublicKey>> keys = CreateKeys(num_keys);
+  if (!keys.ok()) {
+    state.SkipWithError(keys.status().ToString().c_str());
+    return;
+  }
+  for (auto _ : state) {
+    absl::StatusOr<ElGamalPublicKey> combined_key =
+        CombineElGamalPublicKeys(kCurveId, *keys, num_threads);
+    if (!combined_key.ok()) {
+      state.SkipWithError(combined_key.status().ToString().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(combined_key);
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+}
+BENCHMARK(BM_CombineElGamalPublicKeys)
+    ->ArgNames({"keys", "threads"})
+    ->ArgsProduct({{10, 100, 1'000, 10'000}, {1, 4}});
+
+}  // namespace
+}  // namespace wfa::any_sketch::crypto
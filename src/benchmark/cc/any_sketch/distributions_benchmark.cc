@@ -0,0 +1,231 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "any_sketch/distributions.h"
+#include "benchmark/benchmark.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+
+namespace wfa::any_sketch {
+namespace {
+
+// Each benchmark iteration maps kNumChunks * kChunkSize = 1e8 fingerprints,
+// reusing one chunk of random fingerprints.
+constexpr size_t kChunkSize = 100'000;
+constexpr int kNumChunks = 1'000;
+
+std::vector<uint64_t> MakeFingerprints() {
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> fingerprints(kChunkSize);
+  for (uint64_t& fingerprint : fingerprints) {
+    fingerprint = random();
+  }
+  return fingerprints;
+}
+
+// The implementation that GeometricDistribution used before switching to
+// absl::countr_zero, kept as a baseline.
+int LegacyCountTrailingZeros(uint64_t n) {
+  if (n == 0) {
+    return 64;
+  }
+  int c = 63;
+  n &= ~n + 1;
+  if (n & 0x00000000FFFFFFFF) c -= 32;
+  if (n & 0x0000FFFF0000FFFF) c -= 16;
+  if (n & 0x00FF00FF00FF00FF) c -= 8;
+  if (n & 0x0F0F0F0F0F0F0F0F) c -= 4;
+  if (n & 0x3333333333333333) c -= 2;
+  if (n & 0x5555555555555555) c -= 1;
+  return c;
+}
+
+void BM_GeometricLegacy(benchmark::State& state) {
+  const std::vector<uint64_t> fingerprints = MakeFingerprints();
+  std::vector<int64_t> values(kChunkSize);
+  constexpr int64_t kMinValue = 0;
+  constexpr int64_t kMaxValue = 63;
+  for (auto _ : state) {
+    for (int chunk = 0; chunk < kNumChunks; ++chunk) {
+      for (size_t i = 0; i < kChunkSize; ++i) {
+        const int trailing_zeros = LegacyCountTrailingZeros(fingerprints[i]);
+        values[i] = std::min(kMaxValue, kMinValue + trailing_zeros);
+      }
+      benchmark::DoNotOptimize(values.data());
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumChunks * kChunkSize);
+}
+BENCHMARK(BM_GeometricLegacy)->Unit(benchmark::kMillisecond);
+
+void BM_GeometricApplyToFingerprints(benchmark::State& state) {
+  const std::vector<uint64_t> fingerprints = MakeFingerprints();
+  std::vector<int64_t> values(kChunkSize);
+  std::unique_ptr<BaseDistribution> distribution =
+      GetGeometricDistribution(&GetFarmFingerprinter(), 0, 63);
+  for (auto _ : state) {
+    for (int chunk = 0; chunk < kNumChunks; ++chunk) {
+      benchmark::DoNotOptimize(distribution->ApplyToFingerprints(
+          fingerprints, absl::MakeSpan(values)));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumChunks * kChunkSize);
+}
+BENCHMARK(BM_GeometricApplyToFingerprints)->Unit(benchmark::kMillisecond);
+
+// A uniform distribution over [0, kUniformSize), as used by Bloom filters.
+constexpr int64_t kUniformSize = 10'000'000;
+
+void BM_UniformDivision(benchmark::State& state) {
+  const std::vector<uint64_t> fingerprints = MakeFingerprints();
+  std::vector<int64_t> values(kChunkSize);
+  // Keeps the compiler from replacing the division by a multiplication, as it
+  // can't for sizes only known at run time.
+  uint64_t size = kUniformSize;
+  benchmark::DoNotOptimize(size);
+  for (auto _ : state) {
+    for (int chunk = 0; chunk < kNumChunks; ++chunk) {
+      for (size_t i = 0; i < kChunkSize; ++i) {
+        values[i] = fingerprints[i] % size;
+      }
+      benchmark::DoNotOptimize(values.data());
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumChunks * kChunkSize);
+}
+BENCHMARK(BM_UniformDivision)->Unit(benchmark::kMillisecond);
+
+void BM_UniformApplyToFingerprints(benchmark::State& state) {
+  const std::vector<uint64_t> fingerprints = MakeFingerprints();
+  std::vector<int64_t> values(kChunkSize);
+  std::unique_ptr<BaseDistribution> distribution =
+      GetUniformDistribution(&GetFarmFingerprinter(), 0, kUniformSize - 1,
+                             static_cast<RangeReduction>(state.range(0)));
+  for (auto _ : state) {
+    for (int chunk = 0; chunk < kNumChunks; ++chunk) {
+      benchmark::DoNotOptimize(distribution->ApplyToFingerprints(
+          fingerprints, absl::MakeSpan(values)));
+      benchmark::ClobberMemory();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumChunks * kChunkSize);
+}
+BENCHMARK(BM_UniformApplyToFingerprints)
+    ->ArgName("range_reduction")
+    ->Arg(static_cast<int>(RangeReduction::kModulo))
+    ->Arg(static_cast<int>(RangeReduction::kMultiplyShift))
+    ->Unit(benchmark::kMillisecond);
+
+std::unique_ptr<BaseDistribution> MakeOracle() {
+  return GetOracleDistribution("frequency", 0, 100);
+}
+std::unique_ptr<BaseDistribution> MakeUniform() {
+  return GetUniformDistribution(&GetFarmFingerprinter(), 0, kUniformSize - 1);
+}
+std::unique_ptr<BaseDistribution> MakeExponential() {
+  return GetExponentialDistribution(&GetFarmFingerprinter(), 12, 100'000);
+}
+std::unique_ptr<BaseDistribution> MakeGeometric() {
+  return GetGeometricDistribution(&GetFarmFingerprinter(), 0, 63);
+}
+std::unique_ptr<BaseDistribution> MakeConstant() {
+  return GetConstantDistribution(1);
+}
+std::unique_ptr<BaseDistribution> MakeVerbatim() {
+  const std::vector<double> probabilities = {0.5, 0.25, 0.125, 0.125};
+  return GetVerbatimDistribution(&GetFarmFingerprinter(), probabilities);
+}
+std::unique_ptr<BaseDistribution> MakeDiracMixture() {
+  const std::vector<DiracDelta> deltas = {{.alpha = 0.25, .activity = 4},
+                                          {.alpha = 0.75, .activity = 1}};
+  return GetDiracMixtureDistribution(&GetFarmFingerprinter(), deltas,
+                                     100'000);
+}
+
+using DistributionFactory = std::unique_ptr<BaseDistribution> (*)();
+
+// Items are 16 bytes: a fixed prefix followed by a counter.
+class ItemGenerator {
+ public:
+  absl::string_view Next() {
+    std::memcpy(buffer_.data() + 8, &counter_, sizeof(counter_));
+    ++counter_;
+    return absl::string_view(buffer_.data(), buffer_.size());
+  }
+
+ private:
+  std::array<char, 16> buffer_ = {'i', 't', 'e', 'm', '-'};
+  uint64_t counter_ = 0;
+};
+
+// Applies the distribution to one item at a time, fingerprinting each.
+void BM_Apply(benchmark::State& state, DistributionFactory factory) {
+  std::unique_ptr<BaseDistribution> distribution = factory();
+  const ItemMetadata item_metadata = {{"frequency", 3}};
+  ItemGenerator items;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(distribution->Apply(items.Next(), item_metadata));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Applies the distribution to batches of kChunkSize items.
+void BM_ApplyBatch(benchmark::State& state, DistributionFactory factory) {
+  std::unique_ptr<BaseDistribution> distribution = factory();
+  ItemGenerator generator;
+  std::vector<std::string> item_storage(kChunkSize);
+  std::vector<absl::string_view> items(kChunkSize);
+  for (size_t i = 0; i < kChunkSize; ++i) {
+    item_storage[i] = std::string(generator.Next());
+    items[i] = item_storage[i];
+  }
+  const std::vector<ItemMetadata> item_metadata(kChunkSize,
+                                                {{"frequency", 3}});
+  std::vector<int64_t> values(kChunkSize);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        distribution->ApplyBatch(items, item_metadata, absl::MakeSpan(values)));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kChunkSize);
+}
+
+#define BENCHMARK_DISTRIBUTIONS(benchmark_function)                    \
+  BENCHMARK_CAPTURE(benchmark_function, oracle, MakeOracle);           \
+  BENCHMARK_CAPTURE(benchmark_function, uniform, MakeUniform);         \
+  BENCHMARK_CAPTURE(benchmark_function, exponential, MakeExponential); \
+  BENCHMARK_CAPTURE(benchmark_function, geometric, MakeGeometric);     \
+  BENCHMARK_CAPTURE(benchmark_function, constant, MakeConstant);       \
+  BENCHMARK_CAPTURE(benchmark_function, verbatim, MakeVerbatim);       \
+  BENCHMARK_CAPTURE(benchmark_function, dirac_mixture, MakeDiracMixture)
+
+BENCHMARK_DISTRIBUTIONS(BM_Apply);
+BENCHMARK_DISTRIBUTIONS(BM_ApplyBatch);
+
+}  // namespace
+}  // namespace wfa::any_sketch
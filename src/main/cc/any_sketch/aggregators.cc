@@ -14,8 +14,11 @@
 
 #include "any_sketch/aggregators.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 
+#include "absl/types/span.h"
 #include "glog/logging.h"
 
 namespace wfa::any_sketch {
@@ -23,14 +26,14 @@ namespace {
 class SumAggregator : public Aggregator {
  public:
   int64_t Aggregate(int64_t value1, int64_t value2) const override {
-    return value1 + value2;
+    return AggregateValue<AggregatorType::kSum>(value1, value2);
   }
 };
 
 class UniqueAggregator : public Aggregator {
  public:
   int64_t Aggregate(int64_t value1, int64_t value2) const override {
-    return (value1 == value2) ? value1 : kUniqueAggregatorDestroyedValue;
+    return AggregateValue<AggregatorType::kUnique>(value1, value2);
   }
   int64_t EncodeToProtoValue(int64_t value) const override { return value + 1; }
   int64_t DecodeFromProtoValue(int64_t value) const override {
@@ -47,12 +50,74 @@ const Aggregator& GetUniqueAggregator() {
   static const Aggregator* const aggregator = new UniqueAggregator();
   return *aggregator;
 }
+
+// Kernel for registers whose values all use the same aggregator. Register
+// boundaries do not matter, so this is a single vectorizable loop.
+template <AggregatorType kType>
+void AggregateUniformRegisters(int64_t* dst, const int64_t* src,
+                               size_t num_values) {
+  for (size_t i = 0; i < num_values; ++i) {
+    dst[i] = AggregateValue<kType>(dst[i], src[i]);
+  }
+}
+
+// Kernel for registers holding one value for each of `kTypes`.
+template <AggregatorType... kTypes>
+void AggregateRegisters(int64_t* dst, const int64_t* src, size_t num_values) {
+  constexpr size_t kRegisterSize = sizeof...(kTypes);
+  for (size_t i = 0; i < num_values; i += kRegisterSize) {
+    size_t j = i;
+    ((dst[j] = AggregateValue<kTypes>(dst[j], src[j]), ++j), ...);
+  }
+}
+
+constexpr AggregatorType kS = AggregatorType::kSum;
+constexpr AggregatorType kU = AggregatorType::kUnique;
+
+// Kernels for registers of two and three values, indexed by a bit mask that
+// has bit i set if value i uses the kUnique aggregator.
+constexpr AggregationKernel kTwoValueKernels[] = {
+    &AggregateRegisters<kS, kS>,
+    &AggregateRegisters<kU, kS>,
+    &AggregateRegisters<kS, kU>,
+    &AggregateRegisters<kU, kU>,
+};
+constexpr AggregationKernel kThreeValueKernels[] = {
+    &AggregateRegisters<kS, kS, kS>, &AggregateRegisters<kU, kS, kS>,
+    &AggregateRegisters<kS, kU, kS>, &AggregateRegisters<kU, kU, kS>,
+    &AggregateRegisters<kS, kS, kU>, &AggregateRegisters<kU, kS, kU>,
+    &AggregateRegisters<kS, kU, kU>, &AggregateRegisters<kU, kU, kU>,
+};
 }  // namespace
 
 int64_t Aggregator::EncodeToProtoValue(int64_t value) const { return value; }
 
 int64_t Aggregator::DecodeFromProtoValue(int64_t value) const { return value; }
 
+AggregationKernel GetAggregationKernel(absl::Span<const AggregatorType> types) {
+  if (types.empty()) {
+    return nullptr;
+  }
+  if (std::all_of(types.begin(), types.end(),
+                  [](AggregatorType type) { return type == kS; })) {
+    return &AggregateUniformRegisters<kS>;
+  }
+  if (std::all_of(types.begin(), types.end(),
+                  [](AggregatorType type) { return type == kU; })) {
+    return &AggregateUniformRegisters<kU>;
+  }
+  if (types.size() > 3) {
+    return nullptr;
+  }
+  size_t mask = 0;
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (types[i] == kU) {
+      mask |= size_t{1} << i;
+    }
+  }
+  return types.size() == 2 ? kTwoValueKernels[mask] : kThreeValueKernels[mask];
+}
+
 const Aggregator& GetAggregator(AggregatorType type) {
   switch (type) {
     case AggregatorType::kSum:
@@ -15,9 +15,12 @@
 #ifndef SRC_MAIN_CC_ANY_SKETCH_AGGREGATORS_H_
 #define SRC_MAIN_CC_ANY_SKETCH_AGGREGATORS_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 
+#include "absl/types/span.h"
+
 namespace wfa::any_sketch {
 
 enum class AggregatorType { kSum, kUnique };
@@ -42,6 +45,29 @@ const Aggregator& GetAggregator(AggregatorType type);
 
 inline constexpr int64_t kUniqueAggregatorDestroyedValue = -1;
 
+// Combines two values the same way as the Aggregator of type `kType`, but
+// without a virtual call, so that loops over it can be inlined and vectorized.
+template <AggregatorType kType>
+inline int64_t AggregateValue(int64_t value1, int64_t value2) {
+  if constexpr (kType == AggregatorType::kSum) {
+    return value1 + value2;
+  } else {
+    static_assert(kType == AggregatorType::kUnique);
+    return (value1 == value2) ? value1 : kUniqueAggregatorDestroyedValue;
+  }
+}
+
+// Aggregates the values of `src` into the values of `dst`. Both hold
+// `num_values` values, which make up one or more registers laid out one after
+// another.
+using AggregationKernel = void (*)(int64_t* dst, const int64_t* src,
+                                   size_t num_values);
+
+// Returns a kernel specialized for registers whose values are aggregated by
+// `types`, or nullptr if there is none and each value has to be aggregated with
+// GetAggregator.
+AggregationKernel GetAggregationKernel(absl::Span<const AggregatorType> types);
+
 }  // namespace wfa::any_sketch
 
 #endif  // SRC_MAIN_CC_ANY_SKETCH_AGGREGATORS_H_
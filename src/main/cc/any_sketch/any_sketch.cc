@@ -17,33 +17,136 @@
 #include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
 #include <type_traits>
 #include <utility>
 
 #include "absl/base/macros.h"
 #include "absl/container/fixed_array.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/numeric/bits.h"
+#include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "any_sketch/aggregators.h"
+#include "any_sketch/derived_fingerprinter.h"
 #include "any_sketch/distributions.h"
+#include "any_sketch/parallel_for.h"
 #include "any_sketch/value_function.h"
 #include "common_cpp/macros/macros.h"
 
 namespace wfa::any_sketch {
+namespace {
+constexpr uint64_t kBitsPerWord = 64;
+
+// Returns one more than the largest linearized index that GetIndexes can
+// produce for these index distributions, or 0 if that does not fit in 64 bits.
+uint64_t GetIndexSpaceSize(
+    absl::Span<const std::unique_ptr<BaseDistribution>> indexes) {
+  absl::uint128 product = 1;
+  absl::uint128 max_linearized_index = 0;
+  for (const std::unique_ptr<BaseDistribution>& distribution : indexes) {
+    const int64_t size = distribution->size();
+    if (size <= 0) {
+      return 0;
+    }
+    // Mirrors the linearization in GetIndexes with every index part at its
+    // maximum, which yields the largest linearized index.
+    max_linearized_index = product * max_linearized_index + (size - 1);
+    product *= size;
+    if (max_linearized_index >= std::numeric_limits<uint64_t>::max() ||
+        product > std::numeric_limits<uint64_t>::max()) {
+      return 0;
+    }
+  }
+  return absl::Uint128Low64(max_linearized_index) + 1;
+}
+
+// Calls `fn(first, count)` for each run of consecutive set bits in `bits`,
+// where `first` is the position of the lowest bit of the run.
+template <typename Fn>
+void ForEachRun(uint64_t bits, Fn fn) {
+  while (bits != 0) {
+    const int first = absl::countr_zero(bits);
+    const int count = absl::countr_one(bits >> first);
+    fn(first, count);
+    if (first + count == kBitsPerWord) {
+      return;
+    }
+    bits &= ~uint64_t{0} << (first + count);
+  }
+}
+}  // namespace
 
 AnySketch::AnySketch(std::vector<std::unique_ptr<BaseDistribution>> indexes,
-                     std::vector<ValueFunction> values)
+                     std::vector<ValueFunction> values,
+                     const AnySketchOptions& options)
     : indexes_(indexes.size()), values_(values.size()) {
   std::move(indexes.begin(), indexes.end(), indexes_.begin());
   std::move(values.begin(), values.end(), values_.begin());
+
+  absl::FixedArray<AggregatorType> aggregator_types(values_.size());
+  for (size_t i = 0; i < values_.size(); ++i) {
+    aggregator_types[i] = values_[i].aggregator_type;
+  }
+  aggregation_kernel_ = GetAggregationKernel(aggregator_types);
+
+  distribution_sources_.reserve(indexes_.size() + values_.size());
+  for (const std::unique_ptr<BaseDistribution>& distribution : indexes_) {
+    distribution_sources_.push_back(AddDistributionSource(*distribution));
+  }
+  for (const ValueFunction& value : values_) {
+    distribution_sources_.push_back(AddDistributionSource(*value.distribution));
+  }
+
+  const uint64_t index_space = GetIndexSpaceSize(indexes_);
+  if (index_space > 0 && index_space <= options.max_dense_index_space) {
+    dense_index_space_ = index_space;
+    register_values_.resize(index_space * register_size());
+    dense_occupied_.resize((index_space + kBitsPerWord - 1) / kBitsPerWord);
+  }
 }
 
 size_t AnySketch::register_size() const { return values_.size(); }
 
+size_t AnySketch::num_registers() const {
+  if (!is_dense()) {
+    return sparse_indexes_.size();
+  }
+  size_t count = 0;
+  for (uint64_t word : dense_occupied_) {
+    count += absl::popcount(word);
+  }
+  return count;
+}
+
+void AnySketch::ReserveSparse(size_t num_registers) {
+  sparse_slots_.reserve(num_registers);
+  sparse_indexes_.reserve(num_registers);
+  register_values_.reserve(num_registers * register_size());
+}
+
+void AnySketch::AggregateValues(absl::Span<ValueType> register_values,
+                                absl::Span<const ValueType> new_values) const {
+  ABSL_ASSERT(register_values.size() == new_values.size());
+  if (aggregation_kernel_ != nullptr) {
+    aggregation_kernel_(register_values.data(), new_values.data(),
+                        register_values.size());
+    return;
+  }
+  for (size_t i = 0; i < register_values.size(); ++i) {
+    const Aggregator& aggregator =
+        GetAggregator(values_[i % register_size()].aggregator_type);
+    register_values[i] =
+        aggregator.Aggregate(register_values[i], new_values[i]);
+  }
+}
+
 absl::Status AnySketch::AggregateIntoRegister(
     int64_t index, absl::Span<const int64_t> new_values) {
   if (new_values.size() != register_size()) {
@@ -53,36 +156,148 @@ absl::Status AnySketch::AggregateIntoRegister(
   }
   ABSL_ASSERT(new_values.size() == register_size());
 
-  auto [register_itr, inserted] =
-      registers_.try_emplace(index, register_size());
-  absl::FixedArray<ValueType>& register_values = register_itr->second;
+  if (is_dense()) {
+    return AggregateIntoDenseRegister(index, new_values);
+  }
 
+  auto [slot_itr, inserted] =
+      sparse_slots_.try_emplace(index, sparse_indexes_.size());
   if (inserted) {
-    std::copy(new_values.begin(), new_values.end(), register_values.begin());
+    sparse_indexes_.push_back(index);
+    register_values_.insert(register_values_.end(), new_values.begin(),
+                            new_values.end());
     return absl::OkStatus();
   }
 
   // Otherwise, merge.
-  for (size_t i = 0; i < register_values.size(); ++i) {
-    const Aggregator& aggregator = GetAggregator(values_[i].aggregator_type);
-    register_values[i] =
-        aggregator.Aggregate(register_values[i], new_values[i]);
+  const size_t offset = slot_itr->second * register_size();
+  AggregateValues(
+      absl::MakeSpan(register_values_.data() + offset, register_size()),
+      new_values);
+  return absl::OkStatus();
+}
+
+absl::Status AnySketch::AggregateIntoDenseRegister(
+    uint64_t index, absl::Span<const ValueType> new_values) {
+  if (index >= dense_index_space_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Index ", index, " is outside of the index space of size ",
+                     dense_index_space_));
+  }
+  absl::Span<ValueType> register_values = absl::MakeSpan(
+      register_values_.data() + index * register_size(), register_size());
+  uint64_t& occupied_word = dense_occupied_[index / kBitsPerWord];
+  const uint64_t occupied_bit = uint64_t{1} << (index % kBitsPerWord);
+
+  if (!(occupied_word & occupied_bit)) {
+    occupied_word |= occupied_bit;
+    std::copy(new_values.begin(), new_values.end(), register_values.begin());
+    return absl::OkStatus();
   }
+
+  AggregateValues(register_values, new_values);
   return absl::OkStatus();
 }
 
-absl::StatusOr<int64_t> AnySketch::GetIndex(
-    absl::string_view item, const ItemMetadata& item_metadata) const {
+AnySketch::DistributionSource AnySketch::AddDistributionSource(
+    const BaseDistribution& distribution) {
+  DistributionSource source;
+  if (std::optional<absl::string_view> feature_name =
+          distribution.oracle_feature_name();
+      feature_name.has_value()) {
+    auto itr =
+        std::find(feature_names_.begin(), feature_names_.end(), *feature_name);
+    source.feature = itr - feature_names_.begin();
+    if (itr == feature_names_.end()) {
+      feature_names_.emplace_back(*feature_name);
+    }
+    return source;
+  }
+  const Fingerprinter* fingerprinter = distribution.fingerprinter();
+  if (fingerprinter == nullptr) {
+    return source;
+  }
+  source.derived = dynamic_cast<const DerivedFingerprinter*>(fingerprinter);
+  if (source.derived != nullptr) {
+    fingerprinter = source.derived->base();
+  }
+  auto itr = std::find(item_fingerprinters_.begin(),
+                       item_fingerprinters_.end(), fingerprinter);
+  source.fingerprinter = itr - item_fingerprinters_.begin();
+  if (itr == item_fingerprinters_.end()) {
+    item_fingerprinters_.push_back(fingerprinter);
+  }
+  return source;
+}
+
+absl::Status AnySketch::ApplyDistribution(
+    const BaseDistribution& distribution, const DistributionSource& source,
+    const BatchInputs& inputs, absl::Span<int64_t> values) const {
+  const size_t batch_size = inputs.items.size();
+  if (source.feature >= 0) {
+    return distribution.ApplyToFeatureValues(
+        inputs.feature_columns.subspan(source.feature * batch_size,
+                                       batch_size),
+        values);
+  }
+  if (source.fingerprinter < 0) {
+    return distribution.ApplyBatch(inputs.items, inputs.item_metadata, values);
+  }
+  absl::Span<const uint64_t> fingerprints = inputs.item_fingerprints.subspan(
+      source.fingerprinter * batch_size, batch_size);
+  if (source.derived == nullptr) {
+    return distribution.ApplyToFingerprints(fingerprints, values);
+  }
+  absl::FixedArray<uint64_t> derived_fingerprints(batch_size);
+  for (size_t i = 0; i < batch_size; ++i) {
+    derived_fingerprints[i] = source.derived->Derive(fingerprints[i]);
+  }
+  return distribution.ApplyToFingerprints(derived_fingerprints, values);
+}
+
+absl::Status AnySketch::GetIndexes(const BatchInputs& inputs,
+                                   absl::Span<int64_t> indexes) const {
+  const size_t batch_size = inputs.items.size();
   uint64_t product = 1;
-  uint64_t linearized_index = 0;
-  for (const std::unique_ptr<BaseDistribution>& distribution : indexes_) {
-    ASSIGN_OR_RETURN(int64_t distribution_value,
-                     distribution->Apply(item, item_metadata));
-    int64_t index_part = distribution_value - distribution->min_value();
-    linearized_index = product * linearized_index + index_part;
-    product *= distribution->size();
+  absl::FixedArray<uint64_t> linearized_indexes(batch_size, 0);
+  absl::FixedArray<int64_t> distribution_values(batch_size);
+  for (size_t d = 0; d < indexes_.size(); ++d) {
+    const BaseDistribution& distribution = *indexes_[d];
+    RETURN_IF_ERROR(ApplyDistribution(distribution, distribution_sources_[d],
+                                      inputs,
+                                      absl::MakeSpan(distribution_values)));
+    const int64_t min_value = distribution.min_value();
+    for (size_t i = 0; i < batch_size; ++i) {
+      int64_t index_part = distribution_values[i] - min_value;
+      linearized_indexes[i] = product * linearized_indexes[i] + index_part;
+    }
+    product *= distribution.size();
+  }
+  std::copy(linearized_indexes.begin(), linearized_indexes.end(),
+            indexes.begin());
+  return absl::OkStatus();
+}
+
+absl::Status AnySketch::GetFeatureColumns(
+    size_t num_items, absl::Span<const ItemMetadata> item_metadata,
+    absl::Span<int64_t> feature_columns) const {
+  ABSL_ASSERT(feature_columns.size() == feature_names_.size() * num_items);
+  for (size_t f = 0; f < feature_names_.size(); ++f) {
+    const std::string& feature_name = feature_names_[f];
+    for (size_t j = 0; j < num_items; ++j) {
+      if (item_metadata.empty()) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Could not find key ", feature_name, " in item_metadata"));
+      }
+      auto itr = item_metadata[j].find(feature_name);
+      if (itr == item_metadata[j].end()) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Could not find key ", feature_name, " in item_metadata"));
+      }
+      feature_columns[f * num_items + j] = itr->second;
+    }
   }
-  return linearized_index;
+  return absl::OkStatus();
 }
 
 absl::Status AnySketch::Insert(absl::Span<const unsigned char> item,
@@ -102,50 +317,412 @@ absl::Status AnySketch::Insert(uint64_t item,
 
 absl::Status AnySketch::Insert(absl::string_view item,
                                const ItemMetadata& item_metadata) {
-  ASSIGN_OR_RETURN(int64_t index, GetIndex(item, item_metadata));
-  absl::FixedArray<int64_t> new_values(register_size());
+  return InsertBatch(absl::MakeConstSpan(&item, 1),
+                     absl::MakeConstSpan(&item_metadata, 1));
+}
+
+AnySketch::EncodedItems::EncodedItems(absl::Span<const uint64_t> items)
+    : bytes_(items.size()), views_(items.size()) {
+  for (size_t i = 0; i < items.size(); ++i) {
+    absl::little_endian::Store64(bytes_[i].data(), items[i]);
+    views_[i] = absl::string_view(
+        reinterpret_cast<const char*>(bytes_[i].data()), bytes_[i].size());
+  }
+}
+
+absl::Status AnySketch::ComputeRegisters(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata,
+    absl::Span<const int64_t> feature_columns, absl::Span<int64_t> indexes,
+    absl::Span<ValueType> value_columns) const {
+  if (!item_metadata.empty() && item_metadata.size() != items.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected metadata for ", items.size(), " items but got ",
+                     item_metadata.size()));
+  }
+  if (feature_columns.size() != feature_names_.size() * items.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Expected ", feature_names_.size() * items.size(),
+        " feature values for ", items.size(), " items but got ",
+        feature_columns.size()));
+  }
+  const size_t batch_size = items.size();
+  ABSL_ASSERT(indexes.size() == batch_size);
+  ABSL_ASSERT(value_columns.size() == register_size() * batch_size);
+
+  // Each item is fingerprinted once per distinct fingerprinter, and the
+  // fingerprint of item j by fingerprinter f is at [f * batch_size + j].
+  absl::FixedArray<uint64_t> item_fingerprints(item_fingerprinters_.size() *
+                                               batch_size);
+  for (size_t f = 0; f < item_fingerprinters_.size(); ++f) {
+    for (size_t j = 0; j < batch_size; ++j) {
+      item_fingerprints[f * batch_size + j] =
+          item_fingerprinters_[f]->Fingerprint(items[j]);
+    }
+  }
+
+  const BatchInputs inputs = {.items = items,
+                              .item_metadata = item_metadata,
+                              .feature_columns = feature_columns,
+                              .item_fingerprints = item_fingerprints};
+  RETURN_IF_ERROR(GetIndexes(inputs, indexes));
   for (size_t i = 0; i < register_size(); ++i) {
-    ASSIGN_OR_RETURN(new_values[i],
-                     values_[i].distribution->Apply(item, item_metadata));
+    absl::Span<ValueType> column =
+        value_columns.subspan(i * batch_size, batch_size);
+    RETURN_IF_ERROR(ApplyDistribution(
+        *values_[i].distribution, distribution_sources_[indexes_.size() + i],
+        inputs, column));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AnySketch::AggregateIntoRegisters(
+    absl::Span<const int64_t> indexes,
+    absl::Span<const ValueType> value_columns) {
+  const size_t batch_size = indexes.size();
+  absl::FixedArray<ValueType> new_values(register_size());
+  for (size_t j = 0; j < batch_size; ++j) {
+    for (size_t i = 0; i < register_size(); ++i) {
+      new_values[i] = value_columns[i * batch_size + j];
+    }
+    RETURN_IF_ERROR(AggregateIntoRegister(indexes[j], new_values));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AnySketch::InsertBatch(
+    absl::Span<const uint64_t> items,
+    absl::Span<const ItemMetadata> item_metadata) {
+  EncodedItems encoded_items(items);
+  return InsertBatch(encoded_items.views(), item_metadata);
+}
+
+absl::Status AnySketch::InsertBatch(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata) {
+  const size_t batch_size = items.size();
+  if (!item_metadata.empty() && item_metadata.size() != batch_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected metadata for ", batch_size, " items but got ",
+                     item_metadata.size()));
   }
-  return AggregateIntoRegister(index, new_values);
+  absl::FixedArray<int64_t> feature_columns(feature_names_.size() *
+                                            batch_size);
+  RETURN_IF_ERROR(GetFeatureColumns(batch_size, item_metadata,
+                                    absl::MakeSpan(feature_columns)));
+  absl::FixedArray<int64_t> indexes(batch_size);
+  absl::FixedArray<ValueType> value_columns(register_size() * batch_size);
+  RETURN_IF_ERROR(ComputeRegisters(items, item_metadata, feature_columns,
+                                   absl::MakeSpan(indexes),
+                                   absl::MakeSpan(value_columns)));
+  return AggregateIntoRegisters(indexes, value_columns);
+}
+
+absl::Status AnySketch::InsertWithFeatures(
+    uint64_t item, absl::Span<const int64_t> features) {
+  return InsertBatchWithFeatures(absl::MakeConstSpan(&item, 1), features);
+}
+
+absl::Status AnySketch::InsertWithFeatures(
+    absl::string_view item, absl::Span<const int64_t> features) {
+  return InsertBatchWithFeatures(absl::MakeConstSpan(&item, 1), features);
+}
+
+absl::Status AnySketch::InsertBatchWithFeatures(
+    absl::Span<const uint64_t> items,
+    absl::Span<const int64_t> feature_columns) {
+  EncodedItems encoded_items(items);
+  return InsertBatchWithFeatures(encoded_items.views(), feature_columns);
+}
+
+absl::Status AnySketch::InsertBatchWithFeatures(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const int64_t> feature_columns) {
+  const size_t batch_size = items.size();
+  absl::FixedArray<int64_t> indexes(batch_size);
+  absl::FixedArray<ValueType> value_columns(register_size() * batch_size);
+  RETURN_IF_ERROR(ComputeRegisters(items, /*item_metadata=*/{},
+                                   feature_columns, absl::MakeSpan(indexes),
+                                   absl::MakeSpan(value_columns)));
+  return AggregateIntoRegisters(indexes, value_columns);
 }
 
 absl::Status AnySketch::Merge(const AnySketch& other) {
   // TODO(yunyeng): Check compatibility
-  for (const auto& [item, new_values] : other.registers_) {
-    RETURN_IF_ERROR(AggregateIntoRegister(item, new_values));
+  if (HasSameDenseLayout(other)) {
+    MergeDense(other, 0, dense_occupied_.size());
+    return absl::OkStatus();
+  }
+  for (const Register& reg : other) {
+    RETURN_IF_ERROR(AggregateIntoRegister(reg.index, reg.values));
   }
   return absl::OkStatus();
 }
 
 absl::Status AnySketch::MergeAll(
     absl::Span<const std::unique_ptr<AnySketch>> others) {
-  for (const auto& other : others) {
+  for (const std::unique_ptr<AnySketch>& other : others) {
     RETURN_IF_ERROR(Merge(*other));
   }
   return absl::OkStatus();
 }
 
+absl::Status AnySketch::MergeAll(
+    absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads) {
+  if (num_threads <= 1 || others.empty()) {
+    return MergeAll(others);
+  }
+  // The shards assume valid inputs, and an error after some of them wrote
+  // would leave a partial merge.
+  RETURN_IF_ERROR(ValidateMergeInputs(others));
+  if (is_dense()) {
+    return MergeAllIntoDense(others, num_threads);
+  }
+  return MergeAllIntoSparse(others, num_threads);
+}
+
+absl::Status AnySketch::ValidateMergeInputs(
+    absl::Span<const std::unique_ptr<AnySketch>> others) const {
+  for (const std::unique_ptr<AnySketch>& other : others) {
+    if (other->register_size() != register_size()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Input has wrong dimension. Expected ", register_size(),
+                       " but got ", other->register_size()));
+    }
+    if (!is_dense() || HasSameDenseLayout(*other)) {
+      continue;
+    }
+    for (const Register& reg : *other) {
+      if (reg.index >= dense_index_space_) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Index ", reg.index, " is outside of the index space of size ",
+            dense_index_space_));
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+bool AnySketch::HasSameDenseLayout(const AnySketch& other) const {
+  return is_dense() && other.is_dense() &&
+         dense_index_space_ == other.dense_index_space_ &&
+         register_size() == other.register_size();
+}
+
+void AnySketch::MergeDense(const AnySketch& other, size_t begin_word,
+                           size_t end_word) {
+  const size_t size = register_size();
+  for (size_t word = begin_word; word < end_word; ++word) {
+    const uint64_t other_occupied = other.dense_occupied_[word];
+    if (other_occupied == 0) {
+      continue;
+    }
+    const uint64_t both_occupied = dense_occupied_[word] & other_occupied;
+    const uint64_t first_index = word * kBitsPerWord;
+
+    // Registers that only the other sketch holds are copied over and those
+    // both hold are aggregated, a run of consecutive registers at a time.
+    ForEachRun(other_occupied & ~both_occupied, [&](int first, int count) {
+      const uint64_t offset = (first_index + first) * size;
+      std::copy_n(other.register_values_.data() + offset, count * size,
+                  register_values_.data() + offset);
+    });
+    ForEachRun(both_occupied, [&](int first, int count) {
+      const uint64_t offset = (first_index + first) * size;
+      AggregateValues(
+          absl::MakeSpan(register_values_.data() + offset, count * size),
+          absl::MakeConstSpan(other.register_values_.data() + offset,
+                              count * size));
+    });
+    dense_occupied_[word] |= other_occupied;
+  }
+}
+
+absl::Status AnySketch::MergeAllIntoDense(
+    absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads) {
+  // Each range owns whole words of the occupancy bitmap, and with them the
+  // registers those words cover. ValidateMergeInputs checked that every index
+  // is inside of the index space.
+  const size_t num_words = dense_occupied_.size();
+  const int num_ranges =
+      static_cast<int>(std::min<size_t>(num_threads, num_words));
+  return ParallelFor(num_threads, num_ranges, [&](int range) -> absl::Status {
+    const size_t begin_word = num_words * range / num_ranges;
+    const size_t end_word = num_words * (range + 1) / num_ranges;
+    const uint64_t begin_index = begin_word * kBitsPerWord;
+    const uint64_t end_index = end_word * kBitsPerWord;
+    for (const std::unique_ptr<AnySketch>& other : others) {
+      if (HasSameDenseLayout(*other)) {
+        MergeDense(*other, begin_word, end_word);
+        continue;
+      }
+      for (const Register& reg : *other) {
+        if (reg.index >= begin_index && reg.index < end_index) {
+          RETURN_IF_ERROR(AggregateIntoRegister(reg.index, reg.values));
+        }
+      }
+    }
+    return absl::OkStatus();
+  });
+}
+
+absl::Status AnySketch::MergeAllIntoSparse(
+    absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads) {
+  // Registers that this sketch does not hold yet, collected by one shard.
+  struct NewRegisters {
+    absl::flat_hash_map<uint64_t, size_t> slots;
+    std::vector<uint64_t> indexes;
+    std::vector<ValueType> values;
+    // Where the register was first seen, counting the registers of all the
+    // other sketches in merge order.
+    std::vector<size_t> first_seen;
+  };
+
+  const size_t size = register_size();
+  const auto get_shard = [num_threads](uint64_t index) {
+    return static_cast<int>((index / kBitsPerWord) % num_threads);
+  };
+
+  // The registers of each other sketch, partitioned by shard in one pass per
+  // sketch, so that every shard only visits its own registers.
+  struct ShardRegister {
+    Register reg;
+    // Position of the register within its sketch.
+    size_t position;
+  };
+  const int num_others = static_cast<int>(others.size());
+  std::vector<std::vector<ShardRegister>> buckets(
+      static_cast<size_t>(num_others) * num_threads);
+  std::vector<size_t> other_sizes(num_others);
+  RETURN_IF_ERROR(ParallelFor(num_threads, num_others, [&](int other) {
+    std::vector<ShardRegister>* other_buckets =
+        buckets.data() + static_cast<size_t>(other) * num_threads;
+    size_t position = 0;
+    for (const Register& reg : *others[other]) {
+      other_buckets[get_shard(reg.index)].push_back({reg, position++});
+    }
+    other_sizes[other] = position;
+    return absl::OkStatus();
+  }));
+  // Where the registers of each other sketch start, counting the registers of
+  // all the other sketches in merge order.
+  std::vector<size_t> other_offsets(num_others);
+  for (int other = 1; other < num_others; ++other) {
+    other_offsets[other] = other_offsets[other - 1] + other_sizes[other - 1];
+  }
+
+  // Registers already in this sketch are aggregated in place, as no two
+  // shards write to the same slot and sparse_slots_ is only read.
+  std::vector<NewRegisters> new_registers(num_threads);
+  RETURN_IF_ERROR(ParallelFor(num_threads, num_threads, [&](int shard) {
+    NewRegisters& shard_registers = new_registers[shard];
+    for (int other = 0; other < num_others; ++other) {
+      for (const auto& [reg, position] :
+           buckets[static_cast<size_t>(other) * num_threads + shard]) {
+        if (auto itr = sparse_slots_.find(reg.index);
+            itr != sparse_slots_.end()) {
+          AggregateValues(
+              absl::MakeSpan(register_values_.data() + itr->second * size,
+                             size),
+              reg.values);
+          continue;
+        }
+        auto [slot_itr, inserted] = shard_registers.slots.try_emplace(
+            reg.index, shard_registers.indexes.size());
+        if (inserted) {
+          shard_registers.indexes.push_back(reg.index);
+          shard_registers.first_seen.push_back(other_offsets[other] +
+                                               position);
+          shard_registers.values.insert(shard_registers.values.end(),
+                                        reg.values.begin(), reg.values.end());
+        } else {
+          AggregateValues(
+              absl::MakeSpan(
+                  shard_registers.values.data() + slot_itr->second * size,
+                  size),
+              reg.values);
+        }
+      }
+    }
+    return absl::OkStatus();
+  }));
+
+  // Appends the new registers in the order the serial merge would have. Every
+  // new register was first seen at a distinct position.
+  struct NewRegister {
+    size_t first_seen;
+    const NewRegisters* shard_registers;
+    size_t slot;
+  };
+  std::vector<NewRegister> appends;
+  for (const NewRegisters& shard_registers : new_registers) {
+    for (size_t slot = 0; slot < shard_registers.indexes.size(); ++slot) {
+      appends.push_back(
+          {shard_registers.first_seen[slot], &shard_registers, slot});
+    }
+  }
+  std::sort(appends.begin(), appends.end(),
+            [](const NewRegister& a, const NewRegister& b) {
+              return a.first_seen < b.first_seen;
+            });
+  ReserveSparse(sparse_indexes_.size() + appends.size());
+  for (const NewRegister& new_register : appends) {
+    const uint64_t index =
+        new_register.shard_registers->indexes[new_register.slot];
+    sparse_slots_.emplace(index, sparse_indexes_.size());
+    sparse_indexes_.push_back(index);
+    const ValueType* values =
+        new_register.shard_registers->values.data() + new_register.slot * size;
+    register_values_.insert(register_values_.end(), values, values + size);
+  }
+  return absl::OkStatus();
+}
+
+size_t AnySketch::end_position() const {
+  return is_dense() ? dense_index_space_ : sparse_indexes_.size();
+}
+
+size_t AnySketch::NextOccupiedPosition(size_t position) const {
+  if (position >= end_position() || !is_dense()) {
+    // Every sparse slot holds a register.
+    return std::min(position, end_position());
+  }
+  size_t word = position / kBitsPerWord;
+  uint64_t bits =
+      dense_occupied_[word] & (~uint64_t{0} << (position % kBitsPerWord));
+  while (bits == 0) {
+    if (++word == dense_occupied_.size()) {
+      return end_position();
+    }
+    bits = dense_occupied_[word];
+  }
+  return word * kBitsPerWord + absl::countr_zero(bits);
+}
+
+AnySketch::Iterator::Iterator(const AnySketch* sketch, size_t position)
+    : sketch_(sketch), position_(sketch->NextOccupiedPosition(position)) {}
+
 AnySketch::Iterator& AnySketch::Iterator::operator++() {
-  ++pos_;
+  position_ = sketch_->NextOccupiedPosition(position_ + 1);
   return *this;
 }
 
 AnySketch::Register AnySketch::Iterator::operator*() const {
-  return {pos_->first, pos_->second};
+  const size_t size = sketch_->register_size();
+  const ValueType* values = sketch_->register_values_.data() + position_ * size;
+  uint64_t index = sketch_->is_dense() ? position_
+                                       : sketch_->sparse_indexes_[position_];
+  return {index, absl::MakeConstSpan(values, size)};
 }
 
 bool AnySketch::Iterator::operator!=(const Iterator& other) const {
-  return pos_ != other.pos_;
+  return position_ != other.position_;
 }
 
-AnySketch::Iterator AnySketch::begin() const {
-  return Iterator(registers_.begin());
-}
+AnySketch::Iterator AnySketch::begin() const { return Iterator(this, 0); }
 
 AnySketch::Iterator AnySketch::end() const {
-  return Iterator(registers_.end());
+  return Iterator(this, end_position());
 }
 
 }  // namespace wfa::any_sketch
@@ -15,6 +15,7 @@
 #ifndef SRC_MAIN_CC_ANY_SKETCH_ANY_SKETCH_H_
 #define SRC_MAIN_CC_ANY_SKETCH_ANY_SKETCH_H_
 
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -26,16 +27,28 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/derived_fingerprinter.h"
 #include "any_sketch/distributions.h"
 #include "any_sketch/value_function.h"
 #include "common_cpp/fingerprinters/fingerprinters.h"
 
 namespace wfa::any_sketch {
+
+// Options controlling how an AnySketch stores its registers.
+struct AnySketchOptions {
+  // Sketches whose linearized index space holds at most this many registers
+  // store them in one contiguous array instead of a hash map. Set to 0 to
+  // always use the sparse representation.
+  uint64_t max_dense_index_space = uint64_t{1} << 20;
+};
+
 // A generalized sketch class.
 // This sketch class generalizes the data structure required to
 // capture Bloom filters, HLLs, Cascading Legions, Vector of Counts, and
 // other sketch types. It uses a map of register keys to a register
-// value which is a tuple of counts.
+// value which is a tuple of counts. When the index space is small enough, the
+// map is replaced by a dense array of registers and an occupancy bitmap.
 class AnySketch {
  public:
   // Each register of the sketch holds a tuple of ValueTypes. Depending on the
@@ -64,19 +77,21 @@ class AnySketch {
    private:
     friend class AnySketch;
 
-    using MapType = absl::flat_hash_map<uint64_t, absl::FixedArray<ValueType>>;
-    using MapIteratorType = MapType::const_iterator;
-
-    explicit Iterator(MapIteratorType pos) : pos_(pos) {}
+    // Creates an iterator positioned at the first register stored at or after
+    // `position`. Positions are dense indexes for dense sketches and slots for
+    // sparse ones.
+    Iterator(const AnySketch *sketch, size_t position);
 
-    MapIteratorType pos_;
+    const AnySketch *sketch_;
+    size_t position_;
   };
 
   // Creates a new, empty AnySketch.
   //
   // The inputs will be moved from.
   AnySketch(std::vector<std::unique_ptr<BaseDistribution>> indexes,
-            std::vector<ValueFunction> values);
+            std::vector<ValueFunction> values,
+            const AnySketchOptions &options = {});
 
   AnySketch(const AnySketch &) = delete;
   AnySketch &operator=(const AnySketch &) = delete;
@@ -84,6 +99,10 @@ class AnySketch {
   ~AnySketch() = default;
 
   // Merges a set of values into a register.
+  //
+  // A dense sketch (see is_dense()) only holds the indexes of its linearized
+  // index space, and returns INVALID_ARGUMENT for any other index, whereas a
+  // sparse sketch accepts every index.
   ABSL_MUST_USE_RESULT absl::Status AggregateIntoRegister(
       int64_t index, absl::Span<const int64_t> values);
 
@@ -102,8 +121,57 @@ class AnySketch {
   ABSL_MUST_USE_RESULT absl::Status Insert(absl::string_view item,
                                            const ItemMetadata &item_metadata);
 
+  // Adds each of `items` to the Sketch, with the same result as calling Insert
+  // on each item in order.
+  //
+  // `item_metadata` is either empty, in which case every item has empty
+  // metadata, or holds the metadata of each item.
+  //
+  // Indexes and values are computed for the whole batch before any register is
+  // updated, so if an error is returned the Sketch is left unchanged.
+  ABSL_MUST_USE_RESULT absl::Status InsertBatch(
+      absl::Span<const uint64_t> items,
+      absl::Span<const ItemMetadata> item_metadata = {});
+  ABSL_MUST_USE_RESULT absl::Status InsertBatch(
+      absl::Span<const absl::string_view> items,
+      absl::Span<const ItemMetadata> item_metadata = {});
+
+  // Returns the names of the item features read by the OracleDistributions of
+  // the sketch, in slot order. Each name appears once, even if several
+  // distributions read it.
+  absl::Span<const std::string> feature_names() const { return feature_names_; }
+
+  // Adds `item` to the Sketch, where features[i] is the value of the feature
+  // named feature_names()[i]. This gives the same result as Insert with an
+  // ItemMetadata mapping those names to those values, but avoids building a
+  // map for each item.
+  //
+  // Distributions that are neither OracleDistributions nor based on a
+  // fingerprint see empty ItemMetadata.
+  ABSL_MUST_USE_RESULT absl::Status InsertWithFeatures(
+      uint64_t item, absl::Span<const int64_t> features);
+  ABSL_MUST_USE_RESULT absl::Status InsertWithFeatures(
+      absl::string_view item, absl::Span<const int64_t> features);
+
+  // Adds each of `items` to the Sketch, with the same result as calling
+  // InsertWithFeatures on each item in order. Features are laid out column by
+  // column: feature i of item j is feature_columns[i * items.size() + j].
+  //
+  // If an error is returned the Sketch is left unchanged.
+  ABSL_MUST_USE_RESULT absl::Status InsertBatchWithFeatures(
+      absl::Span<const uint64_t> items,
+      absl::Span<const int64_t> feature_columns);
+  ABSL_MUST_USE_RESULT absl::Status InsertBatchWithFeatures(
+      absl::Span<const absl::string_view> items,
+      absl::Span<const int64_t> feature_columns);
+
   // Merges the other sketch into this one. The result is equivalent to
   // sketching the union of the sets that went into this and the other sketch.
+  //
+  // Like AggregateIntoRegister, returns INVALID_ARGUMENT if this sketch is
+  // dense and the other one holds an index outside of its index space, e.g.
+  // when it is sparse. The registers of the other sketch that precede that
+  // index are then already merged.
   ABSL_MUST_USE_RESULT absl::Status Merge(const AnySketch &other);
 
   // Merges all the other sketches into this one. The resuls is equivalent to
@@ -111,19 +179,172 @@ class AnySketch {
   ABSL_MUST_USE_RESULT absl::Status MergeAll(
       absl::Span<const std::unique_ptr<AnySketch>> others);
 
+  // Same as MergeAll(others), but splits the work across up to `num_threads`
+  // threads. Each thread owns a disjoint range of register indexes, so the
+  // registers, their values and their iteration order are identical to those
+  // of the serial merge.
+  ABSL_MUST_USE_RESULT absl::Status MergeAll(
+      absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads);
+
   Iterator begin() const;
 
   Iterator end() const;
 
+  // Returns whether the registers are stored in a dense array.
+  bool is_dense() const { return dense_index_space_ > 0; }
+
+  // Returns the number of registers holding values.
+  size_t num_registers() const;
+
+  // Returns the value functions, in the order of the values of each register.
+  absl::Span<const ValueFunction> value_functions() const { return values_; }
+
  private:
-  absl::flat_hash_map<uint64_t, absl::FixedArray<ValueType>> registers_;
+  friend class ShardedAnySketchBuilder;
+
+  // The little-endian encoding of a batch of uint64 items, which is how
+  // Insert(uint64_t, ...) presents an item to the distributions.
+  class EncodedItems {
+   public:
+    explicit EncodedItems(absl::Span<const uint64_t> items);
+
+    absl::Span<const absl::string_view> views() const { return views_; }
+
+   private:
+    absl::FixedArray<std::array<unsigned char, sizeof(uint64_t)>> bytes_;
+    absl::FixedArray<absl::string_view> views_;
+  };
+
   absl::FixedArray<std::unique_ptr<BaseDistribution>> indexes_;
   absl::FixedArray<ValueFunction> values_;
 
+  // What a distribution is applied to. If neither a feature nor a
+  // fingerprinter is set, it is applied to the items themselves.
+  struct DistributionSource {
+    // Slot of the feature read by an OracleDistribution, or -1.
+    int feature = -1;
+    // Index into item_fingerprinters_, or -1.
+    int fingerprinter = -1;
+    // If set, the fingerprints are derived from those of the fingerprinter.
+    const DerivedFingerprinter *derived = nullptr;
+  };
+
+  // The inputs of the distributions for a batch of items.
+  struct BatchInputs {
+    absl::Span<const absl::string_view> items;
+    // Either empty, or the metadata of each item.
+    absl::Span<const ItemMetadata> item_metadata;
+    // Feature i of item j is at [i * items.size() + j].
+    absl::Span<const int64_t> feature_columns;
+    // The fingerprint of item j by item_fingerprinters_[f] is at
+    // [f * items.size() + j].
+    absl::Span<const uint64_t> item_fingerprints;
+  };
+
+  // The features read by OracleDistributions, in slot order.
+  std::vector<std::string> feature_names_;
+  // The distinct fingerprinters that the distributions need, directly or
+  // through a DerivedFingerprinter. Each item is fingerprinted once with each.
+  std::vector<const Fingerprinter *> item_fingerprinters_;
+  // The source of each index distribution followed by that of each value
+  // distribution.
+  std::vector<DistributionSource> distribution_sources_;
+
+  // The values of the register at position p are stored at
+  // [p * register_size(), (p + 1) * register_size()). For dense sketches the
+  // position of a register is its index; for sparse sketches it is the slot
+  // assigned when the register was first written.
+  std::vector<ValueType> register_values_;
+
+  // Number of registers in the dense array, or 0 if the sketch is sparse.
+  uint64_t dense_index_space_ = 0;
+  // Bit i is set if the dense register with index i holds values.
+  std::vector<uint64_t> dense_occupied_;
+
+  // Maps the index of each sparse register to its slot.
+  absl::flat_hash_map<uint64_t, size_t> sparse_slots_;
+  // The index of the sparse register in each slot.
+  std::vector<uint64_t> sparse_indexes_;
+
+  // Resolved from the aggregator types of values_ at construction, or nullptr
+  // if there is no specialized kernel for them.
+  AggregationKernel aggregation_kernel_ = nullptr;
+
   size_t register_size() const;
 
-  absl::StatusOr<int64_t> GetIndex(absl::string_view item,
-                                   const ItemMetadata &item_metadata) const;
+  // Aggregates `new_values` into `register_values` value by value. Both hold
+  // the same number of consecutive registers.
+  void AggregateValues(absl::Span<ValueType> register_values,
+                       absl::Span<const ValueType> new_values) const;
+
+  absl::Status AggregateIntoDenseRegister(uint64_t index,
+                                          absl::Span<const ValueType> values);
+
+  // Returns INVALID_ARGUMENT unless the registers of all the other sketches
+  // can be merged into this one, as checked by the serial merge.
+  absl::Status ValidateMergeInputs(
+      absl::Span<const std::unique_ptr<AnySketch>> others) const;
+
+  // Returns whether `other` stores its registers in a dense array with the
+  // same layout as this sketch.
+  bool HasSameDenseLayout(const AnySketch &other) const;
+
+  // Merges the registers of `other` held in words [begin_word, end_word) of
+  // the occupancy bitmap. Requires HasSameDenseLayout(other).
+  void MergeDense(const AnySketch &other, size_t begin_word, size_t end_word);
+
+  absl::Status MergeAllIntoDense(
+      absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads);
+  absl::Status MergeAllIntoSparse(
+      absl::Span<const std::unique_ptr<AnySketch>> others, int num_threads);
+
+  // Returns the first position at or after `position` that holds a register,
+  // or end_position() if there is none.
+  size_t NextOccupiedPosition(size_t position) const;
+
+  size_t end_position() const;
+
+  // Returns what `distribution` is applied to, adding its feature to
+  // feature_names_ or its fingerprinter to item_fingerprinters_ if needed.
+  DistributionSource AddDistributionSource(
+      const BaseDistribution &distribution);
+
+  // Applies `distribution`, whose inputs come from `source`, to a batch.
+  absl::Status ApplyDistribution(const BaseDistribution &distribution,
+                                 const DistributionSource &source,
+                                 const BatchInputs &inputs,
+                                 absl::Span<int64_t> values) const;
+
+  // Computes the linearized index of each item of a batch.
+  absl::Status GetIndexes(const BatchInputs &inputs,
+                          absl::Span<int64_t> indexes) const;
+
+  // Looks up the value of each feature of feature_names_ in the metadata of
+  // each of `num_items` items, laid out as feature_columns of BatchInputs.
+  absl::Status GetFeatureColumns(size_t num_items,
+                                 absl::Span<const ItemMetadata> item_metadata,
+                                 absl::Span<int64_t> feature_columns) const;
+
+  // Computes the linearized index and the values of each item of a batch
+  // without touching the registers. Values are laid out column by column: value
+  // i of item j is stored at value_columns[i * items.size() + j].
+  //
+  // `item_metadata` is only passed on to distributions that are neither
+  // OracleDistributions nor based on a fingerprint, which read
+  // `feature_columns` and fingerprints instead.
+  absl::Status ComputeRegisters(absl::Span<const absl::string_view> items,
+                                absl::Span<const ItemMetadata> item_metadata,
+                                absl::Span<const int64_t> feature_columns,
+                                absl::Span<int64_t> indexes,
+                                absl::Span<ValueType> value_columns) const;
+
+  // Aggregates registers computed by ComputeRegisters.
+  absl::Status AggregateIntoRegisters(
+      absl::Span<const int64_t> indexes,
+      absl::Span<const ValueType> value_columns);
+
+  // Reserves space for at least `num_registers` sparse registers.
+  void ReserveSparse(size_t num_registers);
 };
 
 }  // namespace wfa::any_sketch
@@ -0,0 +1,380 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/encrypted_sketch_container.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/macros/macros.h"
+#include "google/protobuf/io/coded_stream.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+using ::google::protobuf::io::CodedInputStream;
+using ::google::protobuf::io::CodedOutputStream;
+using ::google::protobuf::io::ZeroCopyOutputStream;
+
+constexpr char kMagic[4] = {'W', 'E', 'S', 'K'};
+constexpr size_t kChecksumSize = sizeof(uint64_t);
+// The header checksum covers the header up to itself.
+constexpr size_t kHeaderChecksumOffset =
+    kEncryptedSketchHeaderSize - kChecksumSize;
+constexpr size_t kMaxSize = std::numeric_limits<size_t>::max();
+
+uint64_t GetChecksum(absl::string_view data) {
+  return GetFarmFingerprinter().Fingerprint(data);
+}
+
+uint64_t GetBytesPerRegister(const EncryptedSketchHeader& header) {
+  return (uint64_t{header.value_count} + 1) * header.ciphertext_size;
+}
+
+uint64_t GetNumRegisters(const EncryptedSketchHeader& header) {
+  return header.register_count + header.noise_register_count;
+}
+
+uint64_t GetNumChunks(const EncryptedSketchHeader& header) {
+  const uint64_t num_registers = GetNumRegisters(header);
+  return num_registers / header.registers_per_chunk +
+         (num_registers % header.registers_per_chunk != 0);
+}
+
+// Returns the number of registers of chunk i.
+uint64_t GetChunkRegisterCount(const EncryptedSketchHeader& header,
+                               uint64_t i) {
+  return std::min<uint64_t>(header.registers_per_chunk,
+                            GetNumRegisters(header) -
+                                i * header.registers_per_chunk);
+}
+
+void EncodeHeader(const EncryptedSketchHeader& header, uint8_t* target) {
+  std::memcpy(target, kMagic, sizeof(kMagic));
+  uint8_t* field = target + sizeof(kMagic);
+  field = CodedOutputStream::WriteLittleEndian32ToArray(
+      kEncryptedSketchContainerVersion, field);
+  field = CodedOutputStream::WriteLittleEndian32ToArray(
+      static_cast<uint32_t>(header.curve_id), field);
+  field = CodedOutputStream::WriteLittleEndian32ToArray(header.ciphertext_size,
+                                                        field);
+  field =
+      CodedOutputStream::WriteLittleEndian32ToArray(header.value_count, field);
+  field = CodedOutputStream::WriteLittleEndian32ToArray(
+      header.registers_per_chunk, field);
+  field = CodedOutputStream::WriteLittleEndian64ToArray(header.register_count,
+                                                        field);
+  field = CodedOutputStream::WriteLittleEndian64ToArray(
+      header.noise_register_count, field);
+  CodedOutputStream::WriteLittleEndian64ToArray(
+      GetChecksum(absl::string_view(reinterpret_cast<const char*>(target),
+                                    kHeaderChecksumOffset)),
+      field);
+}
+
+// Frames the registers written to it into the chunks of a container. The
+// bytes of a chunk are buffered until it is full, and then written to output
+// followed by their checksum.
+class ChunkingOutputStream : public ZeroCopyOutputStream {
+ public:
+  ChunkingOutputStream(size_t chunk_size, CodedOutputStream& output)
+      : chunk_size_(chunk_size), output_(output) {}
+
+  bool Next(void** data, int* size) override {
+    if (used_ == chunk_size_) {
+      WriteChunk();
+    }
+    // The buffer only grows as the chunk is filled, so a small sketch does not
+    // allocate a whole chunk.
+    const size_t available = std::min<size_t>(
+        chunk_size_ - used_, std::max<size_t>(chunk_.size(), kMinBufferSize));
+    if (chunk_.size() < used_ + available) {
+      chunk_.resize(used_ + available);
+    }
+    *data = chunk_.data() + used_;
+    *size = static_cast<int>(
+        std::min<size_t>(available, std::numeric_limits<int>::max()));
+    used_ += *size;
+    byte_count_ += *size;
+    return true;
+  }
+
+  void BackUp(int count) override {
+    used_ -= count;
+    byte_count_ -= count;
+  }
+
+  int64_t ByteCount() const override { return byte_count_; }
+
+  // Writes the last chunk, which may be partial.
+  void Finish() {
+    if (used_ > 0) {
+      WriteChunk();
+    }
+  }
+
+ private:
+  static constexpr size_t kMinBufferSize = 1 << 16;
+
+  void WriteChunk() {
+    output_.WriteRaw(chunk_.data(), used_);
+    output_.WriteLittleEndian64(
+        GetChecksum(absl::string_view(chunk_.data(), used_)));
+    used_ = 0;
+  }
+
+  const size_t chunk_size_;
+  CodedOutputStream& output_;
+  std::string chunk_;
+  // Number of bytes of chunk_ that belong to the current chunk.
+  size_t used_ = 0;
+  int64_t byte_count_ = 0;
+};
+}  // namespace
+
+absl::StatusOr<EncryptedSketchHeader> ParseEncryptedSketchHeader(
+    absl::string_view data) {
+  if (data.size() < kEncryptedSketchHeaderSize) {
+    return absl::InvalidArgumentError(
+        "The encrypted sketch container is shorter than its header.");
+  }
+  if (std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+    return absl::InvalidArgumentError(
+        "The data is not an encrypted sketch container.");
+  }
+  const uint8_t* field =
+      reinterpret_cast<const uint8_t*>(data.data()) + sizeof(kMagic);
+  uint32_t version;
+  field = CodedInputStream::ReadLittleEndian32FromArray(field, &version);
+  if (version != kEncryptedSketchContainerVersion) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unsupported encrypted sketch container version ", version, "."));
+  }
+  EncryptedSketchHeader header;
+  uint32_t curve_id;
+  uint64_t checksum;
+  field = CodedInputStream::ReadLittleEndian32FromArray(field, &curve_id);
+  field = CodedInputStream::ReadLittleEndian32FromArray(
+      field, &header.ciphertext_size);
+  field =
+      CodedInputStream::ReadLittleEndian32FromArray(field, &header.value_count);
+  field = CodedInputStream::ReadLittleEndian32FromArray(
+      field, &header.registers_per_chunk);
+  field = CodedInputStream::ReadLittleEndian64FromArray(
+      field, &header.register_count);
+  field = CodedInputStream::ReadLittleEndian64FromArray(
+      field, &header.noise_register_count);
+  CodedInputStream::ReadLittleEndian64FromArray(field, &checksum);
+  header.curve_id = static_cast<int>(curve_id);
+  if (checksum != GetChecksum(data.substr(0, kHeaderChecksumOffset))) {
+    return absl::DataLossError(
+        "The checksum of the encrypted sketch header does not match.");
+  }
+  RETURN_IF_ERROR(GetEncryptedSketchContainerSize(header).status());
+  return header;
+}
+
+absl::StatusOr<size_t> GetEncryptedSketchContainerSize(
+    const EncryptedSketchHeader& header) {
+  if (header.ciphertext_size == 0) {
+    return absl::InvalidArgumentError("ciphertext_size should be positive.");
+  }
+  if (header.registers_per_chunk == 0) {
+    return absl::InvalidArgumentError(
+        "registers_per_chunk should be positive.");
+  }
+  if (header.noise_register_count > kMaxSize - header.register_count) {
+    return absl::InvalidArgumentError(
+        "The encrypted sketch has too many registers.");
+  }
+  const uint64_t num_chunks = GetNumChunks(header);
+  if (num_chunks >
+      (kMaxSize - kEncryptedSketchHeaderSize) / kChecksumSize) {
+    return absl::InvalidArgumentError(
+        "The encrypted sketch has too many registers.");
+  }
+  const size_t framing_size =
+      kEncryptedSketchHeaderSize + num_chunks * kChecksumSize;
+  const uint64_t bytes_per_register = GetBytesPerRegister(header);
+  if (GetNumRegisters(header) >
+      (kMaxSize - framing_size) / bytes_per_register) {
+    return absl::InvalidArgumentError(
+        "The encrypted sketch has too many registers.");
+  }
+  return framing_size + GetNumRegisters(header) * bytes_per_register;
+}
+
+absl::Status VerifyEncryptedSketchChunk(const EncryptedSketchHeader& header,
+                                        uint64_t chunk_index,
+                                        absl::string_view chunk) {
+  RETURN_IF_ERROR(GetEncryptedSketchContainerSize(header).status());
+  if (chunk_index >= GetNumChunks(header)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The encrypted sketch has no chunk ", chunk_index, "."));
+  }
+  const size_t registers_size =
+      GetChunkRegisterCount(header, chunk_index) * GetBytesPerRegister(header);
+  if (chunk.size() != registers_size + kChecksumSize) {
+    return absl::DataLossError(
+        absl::StrCat("Chunk ", chunk_index, " has size ", chunk.size(),
+                     " rather than ", registers_size + kChecksumSize, "."));
+  }
+  uint64_t checksum;
+  CodedInputStream::ReadLittleEndian64FromArray(
+      reinterpret_cast<const uint8_t*>(chunk.data()) + registers_size,
+      &checksum);
+  if (checksum != GetChecksum(chunk.substr(0, registers_size))) {
+    return absl::DataLossError(absl::StrCat(
+        "The checksum of chunk ", chunk_index, " does not match."));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WriteEncryptedSketchContainer(
+    const EncryptedSketchHeader& header, absl::string_view ciphertexts,
+    google::protobuf::io::ZeroCopyOutputStream* output) {
+  RETURN_IF_ERROR(GetEncryptedSketchContainerSize(header).status());
+  const uint64_t bytes_per_register = GetBytesPerRegister(header);
+  if (ciphertexts.size() != GetNumRegisters(header) * bytes_per_register) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The ciphertexts have size ", ciphertexts.size(),
+                     " rather than ",
+                     GetNumRegisters(header) * bytes_per_register, "."));
+  }
+  uint8_t encoded_header[kEncryptedSketchHeaderSize];
+  EncodeHeader(header, encoded_header);
+
+  CodedOutputStream stream(output);
+  stream.WriteRaw(encoded_header, sizeof(encoded_header));
+  size_t offset = 0;
+  for (uint64_t i = 0; i < GetNumChunks(header); ++i) {
+    const absl::string_view chunk = ciphertexts.substr(
+        offset, GetChunkRegisterCount(header, i) * bytes_per_register);
+    stream.WriteRaw(chunk.data(), chunk.size());
+    stream.WriteLittleEndian64(GetChecksum(chunk));
+    offset += chunk.size();
+  }
+  stream.Trim();
+  if (stream.HadError()) {
+    return absl::DataLossError(
+        "Failed to write the encrypted sketch container to the output");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status EncryptToContainer(
+    SketchEncrypter& sketch_encrypter, const Sketch& sketch,
+    EncryptSketchRequest::DestroyedRegisterStrategy
+        destroyed_register_strategy,
+    const EncryptSketchRequest::PublisherNoiseParameter*
+        publisher_noise_parameter,
+    uint32_t registers_per_chunk,
+    google::protobuf::io::ZeroCopyOutputStream* output) {
+  EncryptedSketchHeader header = {
+      .curve_id = sketch_encrypter.curve_id(),
+      .ciphertext_size =
+          static_cast<uint32_t>(sketch_encrypter.bytes_per_ciphertext()),
+      .value_count = static_cast<uint32_t>(sketch.config().values_size()),
+      .registers_per_chunk = registers_per_chunk};
+  RETURN_IF_ERROR(GetEncryptedSketchContainerSize(header).status());
+  const uint64_t bytes_per_register = GetBytesPerRegister(header);
+
+  // The size without noise is exact, which tells the sketch registers apart
+  // from the noise registers.
+  ASSIGN_OR_RETURN(size_t registers_size,
+                   sketch_encrypter.EstimateEncryptedSize(
+                       sketch, destroyed_register_strategy, nullptr));
+
+  CodedOutputStream stream(output);
+  ChunkingOutputStream chunks(registers_per_chunk * bytes_per_register,
+                              stream);
+  RETURN_IF_ERROR(sketch_encrypter.EncryptToStream(
+      sketch, destroyed_register_strategy, publisher_noise_parameter,
+      [&](size_t encrypted_size) -> absl::Status {
+        header.register_count = registers_size / bytes_per_register;
+        header.noise_register_count =
+            (encrypted_size - registers_size) / bytes_per_register;
+        RETURN_IF_ERROR(GetEncryptedSketchContainerSize(header).status());
+        uint8_t encoded_header[kEncryptedSketchHeaderSize];
+        EncodeHeader(header, encoded_header);
+        stream.WriteRaw(encoded_header, sizeof(encoded_header));
+        return absl::OkStatus();
+      },
+      &chunks));
+  chunks.Finish();
+  stream.Trim();
+  if (stream.HadError()) {
+    return absl::DataLossError(
+        "Failed to write the encrypted sketch container to the output");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<EncryptedSketchView> EncryptedSketchView::Create(
+    absl::string_view data) {
+  ASSIGN_OR_RETURN(EncryptedSketchHeader header,
+                   ParseEncryptedSketchHeader(data));
+  ASSIGN_OR_RETURN(size_t size, GetEncryptedSketchContainerSize(header));
+  if (data.size() != size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The encrypted sketch container has size ", data.size(),
+                     " rather than ", size, "."));
+  }
+  return EncryptedSketchView(data, header);
+}
+
+uint64_t EncryptedSketchView::num_chunks() const {
+  return GetNumChunks(header_);
+}
+
+uint64_t EncryptedSketchView::bytes_per_register() const {
+  return GetBytesPerRegister(header_);
+}
+
+absl::string_view EncryptedSketchView::GetRegister(uint64_t i) const {
+  const uint64_t chunk = i / header_.registers_per_chunk;
+  const uint64_t offset =
+      kEncryptedSketchHeaderSize +
+      chunk * header_.registers_per_chunk * bytes_per_register() +
+      chunk * kChecksumSize +
+      (i % header_.registers_per_chunk) * bytes_per_register();
+  return data_.substr(offset, bytes_per_register());
+}
+
+absl::string_view EncryptedSketchView::GetChunk(uint64_t i) const {
+  const uint64_t offset =
+      kEncryptedSketchHeaderSize +
+      i * header_.registers_per_chunk * bytes_per_register() +
+      i * kChecksumSize;
+  return data_.substr(offset,
+                      GetChunkRegisterCount(header_, i) * bytes_per_register() +
+                          kChecksumSize);
+}
+
+absl::Status EncryptedSketchView::VerifyChunk(uint64_t i) const {
+  return VerifyEncryptedSketchChunk(header_, i, GetChunk(i));
+}
+
+absl::Status EncryptedSketchView::Verify() const {
+  for (uint64_t i = 0; i < num_chunks(); ++i) {
+    RETURN_IF_ERROR(VerifyChunk(i));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace wfa::any_sketch::crypto
@@ -0,0 +1,152 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_CRYPTO_ENCRYPTED_SKETCH_CONTAINER_H_
+#define SRC_MAIN_CC_ANY_SKETCH_CRYPTO_ENCRYPTED_SKETCH_CONTAINER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "any_sketch/crypto/sketch_encrypter.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "wfa/any_sketch/crypto/sketch_encryption_methods.pb.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+// An encrypted sketch container frames the ciphertexts of an encrypted sketch
+// so that they can be read without parsing them. All integers are
+// little-endian. The container starts with a header of
+// kEncryptedSketchHeaderSize bytes:
+//
+//   magic                 4 bytes  "WESK"
+//   version               uint32   kEncryptedSketchContainerVersion
+//   curve_id              int32
+//   ciphertext_size       uint32
+//   value_count           uint32
+//   registers_per_chunk   uint32
+//   register_count        uint64
+//   noise_register_count  uint64
+//   checksum              uint64   FarmHash fingerprint of the preceding bytes
+//
+// The header determines the size of the rest of the container, which is a
+// sequence of chunks. Every chunk holds registers_per_chunk registers, except
+// for the last one which may hold fewer, followed by the FarmHash fingerprint
+// of these registers. A register is its value_count + 1 ciphertexts. The
+// registers of the sketch come first, followed by the noise registers.
+//
+// Every register is at a fixed offset, and every chunk can be verified on its
+// own, e.g. as it is received.
+namespace wfa::any_sketch::crypto {
+
+inline constexpr uint32_t kEncryptedSketchContainerVersion = 1;
+inline constexpr size_t kEncryptedSketchHeaderSize = 48;
+inline constexpr uint32_t kDefaultRegistersPerChunk = 1 << 12;
+
+// The header of an encrypted sketch container.
+struct EncryptedSketchHeader {
+  int curve_id = 0;
+  // Number of bytes of every ciphertext.
+  uint32_t ciphertext_size = 0;
+  // Number of values of every register, besides its index.
+  uint32_t value_count = 0;
+  uint32_t registers_per_chunk = kDefaultRegistersPerChunk;
+  // Number of registers encrypted from the sketch.
+  uint64_t register_count = 0;
+  uint64_t noise_register_count = 0;
+};
+
+// Parses the header at the front of data, which must hold at least
+// kEncryptedSketchHeaderSize bytes. Returns INVALID_ARGUMENT if they are not
+// a valid header, or DATA_LOSS if their checksum does not match.
+absl::StatusOr<EncryptedSketchHeader> ParseEncryptedSketchHeader(
+    absl::string_view data);
+
+// Returns the size of a container with this header, or INVALID_ARGUMENT if it
+// is not a valid header.
+absl::StatusOr<size_t> GetEncryptedSketchContainerSize(
+    const EncryptedSketchHeader& header);
+
+// Returns DATA_LOSS unless chunk is the whole chunk chunk_index, checksum
+// included, of a container with this header.
+absl::Status VerifyEncryptedSketchChunk(const EncryptedSketchHeader& header,
+                                        uint64_t chunk_index,
+                                        absl::string_view chunk);
+
+// Writes a container with this header to output. ciphertexts is the
+// concatenation of all the registers, noise registers included. Returns
+// INVALID_ARGUMENT if its size does not match the header.
+absl::Status WriteEncryptedSketchContainer(
+    const EncryptedSketchHeader& header, absl::string_view ciphertexts,
+    google::protobuf::io::ZeroCopyOutputStream* output);
+
+// Encrypts sketch as SketchEncrypter::Encrypt does, with publisher noise if
+// publisher_noise_parameter is not null, and writes the result in a container
+// to output. The registers are encrypted and written one chunk at a time, so
+// only one chunk is held in memory. On error, output may hold part of the
+// container.
+absl::Status EncryptToContainer(
+    SketchEncrypter& sketch_encrypter, const wfa::any_sketch::Sketch& sketch,
+    EncryptSketchRequest::DestroyedRegisterStrategy
+        destroyed_register_strategy,
+    const EncryptSketchRequest::PublisherNoiseParameter*
+        publisher_noise_parameter,
+    uint32_t registers_per_chunk,
+    google::protobuf::io::ZeroCopyOutputStream* output);
+
+// A read-only view of a container held in memory, e.g. a mapped file. Only the
+// header is verified on creation, so the chunks should be verified before
+// their registers are trusted. The data must outlive the view.
+class EncryptedSketchView {
+ public:
+  // Returns INVALID_ARGUMENT if data does not start with a valid header or its
+  // size does not match the header.
+  static absl::StatusOr<EncryptedSketchView> Create(absl::string_view data);
+
+  const EncryptedSketchHeader& header() const { return header_; }
+
+  // Number of registers, noise registers included.
+  uint64_t num_registers() const {
+    return header_.register_count + header_.noise_register_count;
+  }
+  uint64_t num_chunks() const;
+
+  // Returns the concatenated ciphertexts of register i, which must be less than
+  // num_registers().
+  absl::string_view GetRegister(uint64_t i) const;
+
+  // Returns chunk i, checksum included, which must be less than num_chunks().
+  absl::string_view GetChunk(uint64_t i) const;
+
+  // Returns DATA_LOSS if the checksum of chunk i does not match.
+  absl::Status VerifyChunk(uint64_t i) const;
+
+  // Verifies all the chunks.
+  absl::Status Verify() const;
+
+ private:
+  EncryptedSketchView(absl::string_view data,
+                      const EncryptedSketchHeader& header)
+      : data_(data), header_(header) {}
+
+  uint64_t bytes_per_register() const;
+
+  absl::string_view data_;
+  EncryptedSketchHeader header_;
+};
+
+}  // namespace wfa::any_sketch::crypto
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_CRYPTO_ENCRYPTED_SKETCH_CONTAINER_H_
@@ -0,0 +1,77 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/fixed_base_table.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "common_cpp/macros/macros.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+using ::private_join_and_compute::BigNum;
+using ::private_join_and_compute::ECGroup;
+using ::private_join_and_compute::ECPoint;
+}  // namespace
+
+absl::StatusOr<FixedBaseTable> FixedBaseTable::Create(const ECPoint& base,
+                                                      int scalar_bits) {
+  const int num_rows = (scalar_bits + kWindowBits - 1) / kWindowBits;
+  std::vector<ECPoint> entries;
+  entries.reserve(num_rows * (kDigits - 1));
+  ASSIGN_OR_RETURN(ECPoint row_base, base.Clone());
+  for (int row = 0; row < num_rows; ++row) {
+    ASSIGN_OR_RETURN(ECPoint multiple, row_base.Clone());
+    entries.push_back(std::move(multiple));
+    for (int digit = 2; digit < kDigits; ++digit) {
+      ASSIGN_OR_RETURN(multiple, entries.back().Add(row_base));
+      entries.push_back(std::move(multiple));
+    }
+    // 2^kWindowBits * row_base.
+    ASSIGN_OR_RETURN(row_base, entries.back().Add(row_base));
+  }
+  return FixedBaseTable(num_rows, std::move(entries));
+}
+
+absl::StatusOr<ECPoint> FixedBaseTable::Mul(const ECGroup& ec_group,
+                                            const BigNum& scalar) const {
+  if (scalar.BitLength() > num_rows_ * kWindowBits) {
+    return absl::InvalidArgumentError("The scalar is too large for the table.");
+  }
+  // Big-endian.
+  const std::string bytes = scalar.ToBytes();
+  const auto get_bit = [&bytes](int bit) -> int {
+    const int byte = static_cast<int>(bytes.size()) - 1 - bit / 8;
+    return byte < 0 ? 0 : (static_cast<uint8_t>(bytes[byte]) >> (bit % 8)) & 1;
+  };
+
+  ASSIGN_OR_RETURN(ECPoint result, ec_group.GetPointAtInfinity());
+  for (int row = 0; row < num_rows_; ++row) {
+    int digit = 0;
+    for (int i = 0; i < kWindowBits; ++i) {
+      digit |= get_bit(row * kWindowBits + i) << i;
+    }
+    if (digit != 0) {
+      ASSIGN_OR_RETURN(result,
+                       result.Add(entries_[row * (kDigits - 1) + digit - 1]));
+    }
+  }
+  return result;
+}
+
+}  // namespace wfa::any_sketch::crypto
@@ -0,0 +1,74 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_CRYPTO_FIXED_BASE_TABLE_H_
+#define SRC_MAIN_CC_ANY_SKETCH_CRYPTO_FIXED_BASE_TABLE_H_
+
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "private_join_and_compute/crypto/big_num.h"
+#include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
+
+namespace wfa::any_sketch::crypto {
+
+// Multiples of a fixed ECPoint, which turn a scalar multiplication into a few
+// point additions. Row i holds d * 2^(i * kWindowBits) * base for every digit
+// d in [1, 2^kWindowBits), so scalar * base is the sum of one entry per row,
+// picked by the corresponding digit of the scalar.
+//
+// Which entries are read and added depends on the scalar, so unlike
+// ECPoint::Mul this is not constant time. It must only be used for public
+// scalars, such as counter values, never for secret ones such as encryption
+// randomness. A constant-time variant, which reads every entry of a row with
+// masks and always adds, was measured to be slower than ECPoint::Mul on
+// P-256, so secret scalars are left to ECPoint::Mul.
+class FixedBaseTable {
+ public:
+  // Number of scalar bits covered by each row.
+  static constexpr int kWindowBits = 6;
+
+  // Builds the table for scalars of up to scalar_bits bits.
+  static absl::StatusOr<FixedBaseTable> Create(
+      const private_join_and_compute::ECPoint& base, int scalar_bits);
+
+  FixedBaseTable(FixedBaseTable&& other) = default;
+  FixedBaseTable& operator=(FixedBaseTable&& other) = default;
+  FixedBaseTable(const FixedBaseTable&) = delete;
+  FixedBaseTable& operator=(const FixedBaseTable&) = delete;
+
+  // Returns scalar * base as a point of ec_group. All the temporary points
+  // belong to ec_group, so threads with their own ECGroup can share a table.
+  // Returns INVALID_ARGUMENT if the scalar has more bits than the table covers.
+  absl::StatusOr<private_join_and_compute::ECPoint> Mul(
+      const private_join_and_compute::ECGroup& ec_group,
+      const private_join_and_compute::BigNum& scalar) const;
+
+ private:
+  static constexpr int kDigits = 1 << kWindowBits;
+
+  FixedBaseTable(int num_rows,
+                 std::vector<private_join_and_compute::ECPoint> entries)
+      : num_rows_(num_rows), entries_(std::move(entries)) {}
+
+  int num_rows_;
+  // Row-major, with kDigits - 1 entries per row.
+  std::vector<private_join_and_compute::ECPoint> entries_;
+};
+
+}  // namespace wfa::any_sketch::crypto
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_CRYPTO_FIXED_BASE_TABLE_H_
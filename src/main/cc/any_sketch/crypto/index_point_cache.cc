@@ -0,0 +1,259 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/index_point_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/cleanup/cleanup.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/macros/macros.h"
+#include "private_join_and_compute/crypto/context.h"
+#include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+using ::private_join_and_compute::Context;
+using ::private_join_and_compute::ECGroup;
+using ::private_join_and_compute::ECPoint;
+
+constexpr char kFileMagic[8] = {'I', 'D', 'X', 'P', 'O', 'I', 'N', 'T'};
+constexpr uint32_t kFileVersion = 1;
+
+// The file starts with this header, in host byte order, followed by
+// num_slots slots.
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t curve_id;
+  uint64_t point_size;
+  uint64_t num_slots;
+};
+
+// Each slot holds a checksum of the rest of the slot, the index and the
+// point, in host byte order.
+constexpr size_t kSlotHeaderSize = 2 * sizeof(uint64_t);
+
+uint64_t GetSlotChecksum(const char* slot, size_t point_size) {
+  return GetFarmFingerprinter().Fingerprint(absl::string_view(
+      slot + sizeof(uint64_t), sizeof(int64_t) + point_size));
+}
+
+// Returns the size of the compressed points of the curve.
+absl::StatusOr<size_t> GetPointSize(int curve_id) {
+  Context ctx;
+  ASSIGN_OR_RETURN(ECGroup ec_group, ECGroup::Create(curve_id, &ctx));
+  ASSIGN_OR_RETURN(ECPoint point, ec_group.GetPointByHashingToCurveSha256(""));
+  ASSIGN_OR_RETURN(std::string bytes, point.ToBytesCompressed());
+  return bytes.size();
+}
+
+absl::Status ErrnoToStatus(absl::string_view operation,
+                           absl::string_view path) {
+  return absl::InternalError(absl::StrCat("Cannot ", operation, " ", path,
+                                          ": ", std::strerror(errno)));
+}
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<IndexPointCache>> IndexPointCache::Create(
+    const IndexPointCacheOptions& options) {
+  if (options.file_path.empty()) {
+    return absl::WrapUnique(
+        new IndexPointCache(options.capacity, std::nullopt));
+  }
+  if (options.file_capacity == 0) {
+    return absl::InvalidArgumentError("file_capacity should be positive.");
+  }
+  ASSIGN_OR_RETURN(size_t point_size, GetPointSize(options.curve_id));
+  const absl::string_view path = options.file_path;
+
+  const int fd = open(options.file_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+                      S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return ErrnoToStatus("open", path);
+  }
+  absl::Cleanup close_fd = [fd] { close(fd); };
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    return ErrnoToStatus("stat", path);
+  }
+
+  FileHeader header;
+  const bool is_new = file_stat.st_size == 0;
+  if (is_new) {
+    std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+    header.version = kFileVersion;
+    header.curve_id = options.curve_id;
+    header.point_size = point_size;
+    header.num_slots = options.file_capacity;
+  } else if (static_cast<size_t>(file_stat.st_size) < sizeof(header) ||
+             pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+             std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+             header.version != kFileVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " is not an index point cache file."));
+  } else if (header.curve_id != options.curve_id ||
+             header.point_size != point_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " holds points of curve ", header.curve_id,
+                     " rather than ", options.curve_id, "."));
+  }
+
+  // Slots are picked modulo num_slots, and the whole file must be mappable.
+  const size_t slot_size = kSlotHeaderSize + point_size;
+  if (header.num_slots == 0 ||
+      header.num_slots >
+          (std::numeric_limits<size_t>::max() - sizeof(header)) / slot_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " cannot hold ", header.num_slots, " slots."));
+  }
+  const size_t file_size = sizeof(header) + header.num_slots * slot_size;
+  if (is_new) {
+    if (ftruncate(fd, file_size) != 0) {
+      return ErrnoToStatus("resize", path);
+    }
+  } else if (static_cast<size_t>(file_stat.st_size) != file_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " has size ", file_stat.st_size, " rather than ",
+                     file_size, "."));
+  }
+  void* data =
+      mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    return ErrnoToStatus("map", path);
+  }
+  if (is_new) {
+    std::memcpy(data, &header, sizeof(header));
+  }
+  return absl::WrapUnique(new IndexPointCache(
+      options.capacity, File{.curve_id = options.curve_id,
+                             .point_size = point_size,
+                             .num_slots = header.num_slots,
+                             .data = static_cast<char*>(data),
+                             .size = file_size}));
+}
+
+IndexPointCache::IndexPointCache(size_t capacity, std::optional<File> file)
+    : capacity_(capacity), file_(std::move(file)) {}
+
+IndexPointCache::~IndexPointCache() {
+  if (file_.has_value()) {
+    munmap(file_->data, file_->size);
+  }
+}
+
+std::optional<std::string> IndexPointCache::Lookup(int curve_id,
+                                                   int64_t index) {
+  absl::MutexLock lock(&mutex_);
+  const Key key = {curve_id, index};
+  if (auto entry = entries_by_key_.find(key); entry != entries_by_key_.end()) {
+    Touch(entry->second);
+    return entry->second->second;
+  }
+  if (!file_.has_value() || file_->curve_id != curve_id) {
+    return std::nullopt;
+  }
+  std::optional<std::string> point = ReadSlot(index);
+  if (point.has_value()) {
+    InsertInMemory(key, *point);
+  }
+  return point;
+}
+
+void IndexPointCache::Insert(int curve_id, int64_t index,
+                             absl::string_view point) {
+  absl::MutexLock lock(&mutex_);
+  InsertInMemory({curve_id, index}, point);
+  if (file_.has_value() && file_->curve_id == curve_id &&
+      file_->point_size == point.size()) {
+    WriteSlot(index, point);
+  }
+}
+
+size_t IndexPointCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+void IndexPointCache::Touch(std::list<Entry>::iterator entry) {
+  entries_.splice(entries_.begin(), entries_, entry);
+}
+
+void IndexPointCache::InsertInMemory(const Key& key, absl::string_view point) {
+  if (capacity_ == 0) {
+    return;
+  }
+  if (auto entry = entries_by_key_.find(key); entry != entries_by_key_.end()) {
+    entry->second->second = std::string(point);
+    Touch(entry->second);
+    return;
+  }
+  if (entries_.size() == capacity_) {
+    entries_by_key_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, std::string(point));
+  entries_by_key_[key] = entries_.begin();
+}
+
+char* IndexPointCache::GetSlot(int64_t index) const {
+  const uint64_t slot_number =
+      GetFarmFingerprinter().Fingerprint(absl::string_view(
+          reinterpret_cast<const char*>(&index), sizeof(index))) %
+      file_->num_slots;
+  return file_->data + sizeof(FileHeader) +
+         slot_number * (kSlotHeaderSize + file_->point_size);
+}
+
+std::optional<std::string> IndexPointCache::ReadSlot(int64_t index) const {
+  const char* slot = GetSlot(index);
+  uint64_t checksum;
+  int64_t slot_index;
+  std::memcpy(&checksum, slot, sizeof(checksum));
+  std::memcpy(&slot_index, slot + sizeof(checksum), sizeof(slot_index));
+  if (slot_index != index ||
+      checksum != GetSlotChecksum(slot, file_->point_size)) {
+    return std::nullopt;
+  }
+  return std::string(slot + kSlotHeaderSize, file_->point_size);
+}
+
+void IndexPointCache::WriteSlot(int64_t index, absl::string_view point) {
+  char* slot = GetSlot(index);
+  std::memcpy(slot + sizeof(uint64_t), &index, sizeof(index));
+  std::memcpy(slot + kSlotHeaderSize, point.data(), point.size());
+  const uint64_t checksum = GetSlotChecksum(slot, file_->point_size);
+  std::memcpy(slot, &checksum, sizeof(checksum));
+}
+
+}  // namespace wfa::any_sketch::crypto
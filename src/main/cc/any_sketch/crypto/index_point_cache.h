@@ -0,0 +1,116 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_CRYPTO_INDEX_POINT_CACHE_H_
+#define SRC_MAIN_CC_ANY_SKETCH_CRYPTO_INDEX_POINT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace wfa::any_sketch::crypto {
+
+// Options of an IndexPointCache.
+struct IndexPointCacheOptions {
+  // Maximum number of points kept in memory. The least recently used point is
+  // evicted first.
+  size_t capacity = 1 << 16;
+  // If not empty, the points of curve_id are also stored in a memory-mapped
+  // table in this file, so that they outlive the process. The file is created
+  // if it does not exist.
+  std::string file_path;
+  // The curve of the points in the file.
+  int curve_id = 0;
+  // Number of points the file holds when it is created. Each index has a
+  // single slot in the file, so a point replaces the one in its slot.
+  size_t file_capacity = 1 << 20;
+};
+
+// A bounded cache of the compressed ECPoints that register indexes hash to,
+// keyed by (curve_id, index). Hashing to the curve dominates the encryption
+// of an index, and sketches that are encrypted repeatedly reuse the same
+// index space. Thread-safe.
+//
+// The file is not locked, so it should be used by one process at a time.
+// Every slot carries a checksum, so a slot torn by a concurrent writer is
+// treated as empty.
+class IndexPointCache {
+ public:
+  // Returns INVALID_ARGUMENT if an existing file was created for another curve
+  // or is malformed, and INTERNAL if the file cannot be mapped.
+  static absl::StatusOr<std::unique_ptr<IndexPointCache>> Create(
+      const IndexPointCacheOptions& options);
+
+  ~IndexPointCache();
+  IndexPointCache(IndexPointCache&& other) = delete;
+  IndexPointCache& operator=(IndexPointCache&& other) = delete;
+  IndexPointCache(const IndexPointCache&) = delete;
+  IndexPointCache& operator=(const IndexPointCache&) = delete;
+
+  // Returns the point that index hashes to on curve_id, if it is cached.
+  std::optional<std::string> Lookup(int curve_id, int64_t index);
+
+  // Caches the point that index hashes to on curve_id.
+  void Insert(int curve_id, int64_t index, absl::string_view point);
+
+  // Number of points in memory.
+  size_t size() const;
+
+ private:
+  using Key = std::pair<int, int64_t>;
+  using Entry = std::pair<Key, std::string>;
+
+  // A memory-mapped table of points.
+  struct File {
+    int curve_id;
+    size_t point_size;
+    size_t num_slots;
+    // The whole mapped file, starting with its header.
+    char* data;
+    size_t size;
+  };
+
+  IndexPointCache(size_t capacity, std::optional<File> file);
+
+  // Moves the entry to the front of the list, making it the most recently
+  // used one.
+  void Touch(std::list<Entry>::iterator entry);
+  void InsertInMemory(const Key& key, absl::string_view point);
+  // Returns the slot of index in the file.
+  char* GetSlot(int64_t index) const;
+  std::optional<std::string> ReadSlot(int64_t index) const;
+  void WriteSlot(int64_t index, absl::string_view point);
+
+  const size_t capacity_;
+  const std::optional<File> file_;
+
+  // Guards the entries and the file.
+  mutable absl::Mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  absl::flat_hash_map<Key, std::list<Entry>::iterator> entries_by_key_;
+};
+
+}  // namespace wfa::any_sketch::crypto
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_CRYPTO_INDEX_POINT_CACHE_H_
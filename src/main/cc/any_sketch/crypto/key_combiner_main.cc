@@ -25,6 +25,8 @@ ABSL_FLAG(int, curve_id, 0, "The Elliptic curve id.");
 ABSL_FLAG(std::vector<std::string>, element_list, {},
           "The list of ElGamal public key elements to combine.");
 
+ABSL_FLAG(int, num_threads, 1, "The number of threads combining the keys.");
+
 using ::wfa::any_sketch::crypto::ElGamalPublicKey;
 
 int main(int argc, char** argv) {
@@ -44,8 +46,9 @@ int main(int argc, char** argv) {
     keys.back().set_element(absl::HexStringToBytes(y));
   }
 
-  auto result =
-      wfa::any_sketch::crypto::CombineElGamalPublicKeys(curveId, keys).value();
+  auto result = wfa::any_sketch::crypto::CombineElGamalPublicKeys(
+                    curveId, keys, absl::GetFlag(FLAGS_num_threads))
+                    .value();
   std::cerr << "\nResult:\n" + absl::BytesToHexString(result.element())
             << std::endl;
 
@@ -14,28 +14,47 @@
 
 #include "any_sketch/crypto/sketch_encrypter.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/memory/memory.h"
+#include "absl/numeric/bits.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "any_sketch/crypto/fixed_base_table.h"
+#include "any_sketch/crypto/index_point_cache.h"
+#include "any_sketch/parallel_for.h"
 #include "common_cpp/macros/macros.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "math/distributed_discrete_gaussian_noiser.h"
 #include "math/distributed_geometric_noiser.h"
 #include "math/distributed_noiser.h"
 #include "math/noise_parameters_computation.h"
-#include "private_join_and_compute/crypto/commutative_elgamal.h"
+#include "private_join_and_compute/crypto/big_num.h"
 #include "private_join_and_compute/crypto/context.h"
 #include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
 #include "wfa/any_sketch/crypto/sketch_encryption_methods.pb.h"
 #include "wfa/any_sketch/differential_privacy.pb.h"
 
 namespace wfa::any_sketch::crypto {
 
 namespace {
+using ::google::protobuf::io::CodedOutputStream;
 using ::private_join_and_compute::BigNum;
-using ::private_join_and_compute::CommutativeElGamal;
 using ::private_join_and_compute::Context;
 using ::private_join_and_compute::ECGroup;
 using ::private_join_and_compute::ECPoint;
@@ -45,14 +64,13 @@ using ::wfa::any_sketch::SketchConfig;
 using DestroyedRegisterStrategy =
     ::wfa::any_sketch::crypto::EncryptSketchRequest::DestroyedRegisterStrategy;
 using BlindersCiphertext = std::pair<std::string, std::string>;
-// Each Compression of ECPoint has size 33-bytes (32 bytes for x, 1 byte for the
-// sign of y). An ElGamal ciphertext contains two ECPoints, i.e., u and e.
-constexpr int kBytesPerCipherText = 66;
 constexpr absl::string_view KUnitECPointSeed = "unit_ec_point";
 constexpr absl::string_view KDestroyedRegisterKey = "destroyed_register_key";
 // The seed for the EcPoint denoting the publisher noise register id.
 constexpr absl::string_view kPublisherNoiseRegisterId =
     "publisher_noise_register_id";
+// Number of registers EncryptToStream encrypts before writing them out.
+constexpr int kRegistersPerStreamChunk = 1 << 12;
 
 // Check if the sketch is valid or not.
 // A Sketch is valid if and only if all its registers contain the same number
@@ -84,228 +102,413 @@ bool IsRegisterDestroyed(const Sketch::Register& reg,
   return false;
 }
 
-// Add ElGamal Encryption to plaintext sketch word by word using the same public
-// key.
-class SketchEncrypterImpl : public SketchEncrypter {
+// Returns the number of ciphertexts the encryption of a register consists of.
+absl::StatusOr<int> GetRegisterCiphertextCount(
+    const Sketch::Register& reg, const SketchConfig& sketch_config,
+    DestroyedRegisterStrategy destroyed_register_strategy) {
+  // The index followed by the values.
+  const int register_size = 1 + reg.values_size();
+  if (!IsRegisterDestroyed(reg, sketch_config)) {
+    return register_size;
+  }
+  switch (destroyed_register_strategy) {
+    case EncryptSketchRequest::CONFLICTING_KEYS:
+      return 2 * register_size;
+    case EncryptSketchRequest::FLAGGED_KEY:
+      return register_size;
+    default:
+      return absl::InvalidArgumentError("Invalid DestroyedRegisterStrategy.");
+  }
+}
+
+// The compressed ECPoints n * P of the SUM counter values n in
+// [1, max_counter_value + 1], where P is the unit ECPoint. Index n - 1 holds
+// n * P.
+using CounterPoints = std::vector<std::string>;
+
+absl::StatusOr<std::shared_ptr<const CounterPoints>> CreateCounterPoints(
+    int curve_id, size_t max_counter_value) {
+  Context ctx;
+  ASSIGN_OR_RETURN(ECGroup ec_group, ECGroup::Create(curve_id, &ctx));
+  ASSIGN_OR_RETURN(ECPoint unit_ec,
+                   ec_group.GetPointByHashingToCurveSha256(KUnitECPointSeed));
+  auto counter_points = std::make_shared<CounterPoints>();
+  counter_points->reserve(max_counter_value + 1);
+  ASSIGN_OR_RETURN(ECPoint multiple, unit_ec.Clone());
+  while (true) {
+    ASSIGN_OR_RETURN(std::string bytes, multiple.ToBytesCompressed());
+    counter_points->push_back(std::move(bytes));
+    if (counter_points->size() == max_counter_value + 1) {
+      break;
+    }
+    ASSIGN_OR_RETURN(multiple, multiple.Add(unit_ec));
+  }
+  return counter_points;
+}
+
+// Returns the counter points of the curve. They are read-only, so all the
+// SketchEncrypters with the same curve and max_counter_value share them while
+// any of them is alive.
+absl::StatusOr<std::shared_ptr<const CounterPoints>> GetSharedCounterPoints(
+    int curve_id, size_t max_counter_value) {
+  static absl::Mutex* const mutex = new absl::Mutex();
+  static auto* const counter_points_by_key =
+      new absl::flat_hash_map<std::pair<int, size_t>,
+                              std::weak_ptr<const CounterPoints>>();
+
+  absl::MutexLock lock(mutex);
+  std::weak_ptr<const CounterPoints>& shared_counter_points =
+      (*counter_points_by_key)[{curve_id, max_counter_value}];
+  if (std::shared_ptr<const CounterPoints> counter_points =
+          shared_counter_points.lock()) {
+    return counter_points;
+  }
+  absl::StatusOr<std::shared_ptr<const CounterPoints>> counter_points =
+      CreateCounterPoints(curve_id, max_counter_value);
+  if (!counter_points.ok()) {
+    counter_points_by_key->erase({curve_id, max_counter_value});
+    return counter_points.status();
+  }
+  shared_counter_points = *counter_points;
+  return counter_points;
+}
+
+// An ECGroup with the Context it works with.
+struct CurveGroup {
+  int curve_id;
+  std::unique_ptr<Context> ctx;
+  std::unique_ptr<ECGroup> ec_group;
+};
+
+// The CurveGroups that are not in use.
+struct IdleCurveGroups {
+  absl::Mutex mutex;
+  absl::flat_hash_map<int, std::vector<std::unique_ptr<CurveGroup>>>
+      by_curve_id;
+};
+
+IdleCurveGroups& GetIdleCurveGroups() {
+  static auto* const idle_curve_groups = new IdleCurveGroups();
+  return *idle_curve_groups;
+}
+
+// Maximum number of idle CurveGroups kept per curve.
+constexpr size_t kMaxIdleCurveGroups = 16;
+
+// Returns a CurveGroup of the curve, reusing an idle one if any. A CurveGroup
+// is not thread safe, so it must be used by one thread until it is released.
+absl::StatusOr<std::unique_ptr<CurveGroup>> AcquireCurveGroup(int curve_id) {
+  IdleCurveGroups& idle_curve_groups = GetIdleCurveGroups();
+  {
+    absl::MutexLock lock(&idle_curve_groups.mutex);
+    auto idle = idle_curve_groups.by_curve_id.find(curve_id);
+    if (idle != idle_curve_groups.by_curve_id.end() && !idle->second.empty()) {
+      std::unique_ptr<CurveGroup> curve_group = std::move(idle->second.back());
+      idle->second.pop_back();
+      return curve_group;
+    }
+  }
+  auto curve_group = absl::make_unique<CurveGroup>();
+  curve_group->curve_id = curve_id;
+  curve_group->ctx = absl::make_unique<Context>();
+  ASSIGN_OR_RETURN_ERROR(ECGroup ec_group,
+                         ECGroup::Create(curve_id, curve_group->ctx.get()),
+                         absl::StrCat("Invalid Curve_id: ", curve_id));
+  curve_group->ec_group = absl::make_unique<ECGroup>(std::move(ec_group));
+  return curve_group;
+}
+
+// Makes a CurveGroup returned by AcquireCurveGroup available for reuse.
+void ReleaseCurveGroup(std::unique_ptr<CurveGroup> curve_group) {
+  IdleCurveGroups& idle_curve_groups = GetIdleCurveGroups();
+  absl::MutexLock lock(&idle_curve_groups.mutex);
+  std::vector<std::unique_ptr<CurveGroup>>& idle =
+      idle_curve_groups.by_curve_id[curve_group->curve_id];
+  if (idle.size() < kMaxIdleCurveGroups) {
+    idle.push_back(std::move(curve_group));
+  }
+}
+
+// Sums the points with a pairwise tree of additions.
+absl::StatusOr<ECPoint> SumECPoints(std::vector<ECPoint> points) {
+  while (points.size() > 1) {
+    const size_t num_sums = (points.size() + 1) / 2;
+    for (size_t i = 0; i < points.size() / 2; ++i) {
+      ASSIGN_OR_RETURN(points[i], points[2 * i].Add(points[2 * i + 1]));
+    }
+    if (points.size() % 2 == 1) {
+      points[num_sums - 1] = std::move(points.back());
+    }
+    points.erase(points.begin() + num_sums, points.end());
+  }
+  return std::move(points.front());
+}
+
+math::DistributedGeometricNoiseComponentOptions GetPublisherNoiseOptions(
+    const EncryptSketchRequest::PublisherNoiseParameter&
+        publisher_noise_parameter) {
+  DifferentialPrivacyParams params;
+  params.set_epsilon(publisher_noise_parameter.epsilon());
+  params.set_delta(publisher_noise_parameter.delta());
+  return math::GetGeometricPublisherNoiseOptions(
+      params, publisher_noise_parameter.publisher_count());
+}
+
+// Returns the number of publisher noise registers to add, which may be
+// negative.
+absl::StatusOr<int64_t> GenerateNoiseCount(
+    const EncryptSketchRequest::PublisherNoiseParameter&
+        publisher_noise_parameter) {
+  std::unique_ptr<math::DistributedNoiser> distributed_noiser =
+      std::make_unique<math::DistributedGeometricNoiser>(
+          GetPublisherNoiseOptions(publisher_noise_parameter));
+  return distributed_noiser->GenerateNoiseComponent();
+}
+
+// Returns the largest number of publisher noise registers GenerateNoiseCount
+// may return. The noise is the shift offset plus the difference of two
+// variables truncated to [0, truncate_threshold].
+absl::StatusOr<int64_t> GetMaxNoiseCount(
+    const EncryptSketchRequest::PublisherNoiseParameter&
+        publisher_noise_parameter) {
+  math::DistributedGeometricNoiseComponentOptions options =
+      GetPublisherNoiseOptions(publisher_noise_parameter);
+  if (options.truncate_threshold < 0) {
+    return absl::InvalidArgumentError("The publisher noise is not bounded.");
+  }
+  return std::max<int64_t>(
+      options.shift_offset + options.truncate_threshold, 0);
+}
+
+// Writes ciphertexts one after the other into a preallocated buffer.
+class CiphertextWriter {
  public:
-  SketchEncrypterImpl(std::unique_ptr<CommutativeElGamal> el_gamal_cipher,
-                      std::unique_ptr<Context> ctx,
-                      std::unique_ptr<ECGroup> ec_group,
-                      size_t max_counter_value);
-  ~SketchEncrypterImpl() override = default;
-  SketchEncrypterImpl(SketchEncrypterImpl&& other) = delete;
-  SketchEncrypterImpl& operator=(SketchEncrypterImpl&& other) = delete;
-  SketchEncrypterImpl(const SketchEncrypterImpl&) = delete;
-  SketchEncrypterImpl& operator=(const SketchEncrypterImpl&) = delete;
+  explicit CiphertextWriter(absl::Span<char> buffer) : buffer_(buffer) {}
 
-  absl::StatusOr<std::string> Encrypt(
-      const Sketch& sketch,
-      DestroyedRegisterStrategy destroyed_register_strategy) override;
+  absl::Status Write(const BlindersCiphertext& ciphertext) {
+    const size_t size = ciphertext.first.size() + ciphertext.second.size();
+    if (size > buffer_.size()) {
+      return absl::InvalidArgumentError(
+          "The buffer is smaller than the encrypted sketch.");
+    }
+    char* next = std::copy(ciphertext.first.begin(), ciphertext.first.end(),
+                           buffer_.data());
+    std::copy(ciphertext.second.begin(), ciphertext.second.end(), next);
+    buffer_.remove_prefix(size);
+    return absl::OkStatus();
+  }
 
-  absl::Status AppendNoiseRegisters(
-      const EncryptSketchRequest::PublisherNoiseParameter&
-          publisher_noise_parameter,
-      int value_count, std::string& encrypted_sketch) override;
+ private:
+  // The part of the buffer that has not been written yet.
+  absl::Span<char> buffer_;
+};
+
+// Encrypts registers word by word using the same public key.
+// Since the underlying private-join-and-computer Context and ECGroup are NOT
+// thread safe, every thread that encrypts owns one RegisterEncrypter.
+class RegisterEncrypter {
+ public:
+  static absl::StatusOr<std::unique_ptr<RegisterEncrypter>> Create(
+      int curve_id, size_t max_counter_value,
+      const CiphertextString& public_key_bytes,
+      std::shared_ptr<const CounterPoints> counter_points,
+      std::shared_ptr<IndexPointCache> index_point_cache);
+
+  RegisterEncrypter(int curve_id, std::unique_ptr<Context> ctx,
+                    std::unique_ptr<ECGroup> ec_group,
+                    size_t max_counter_value);
+  RegisterEncrypter(RegisterEncrypter&& other) = delete;
+  RegisterEncrypter& operator=(RegisterEncrypter&& other) = delete;
+  RegisterEncrypter(const RegisterEncrypter&) = delete;
+  RegisterEncrypter& operator=(const RegisterEncrypter&) = delete;
+
+  // Size of a ciphertext. Each Compression of ECPoint has size 33-bytes (32
+  // bytes for x, 1 byte for the sign of y) on 256-bit curves. An ElGamal
+  // ciphertext contains two ECPoints, i.e., u and e.
+  size_t bytes_per_ciphertext() const { return bytes_per_ciphertext_; }
+
+  int curve_id() const { return curve_id_; }
+
+  // Encrypt a Register and write the result to the writer.
+  absl::Status EncryptAdditionalRegister(
+      const Sketch::Register& reg, const SketchConfig& sketch_config,
+      DestroyedRegisterStrategy destroyed_register_strategy,
+      CiphertextWriter& writer);
+  // Encrypt noise_count noise registers with value_count values each and
+  // write them to the writer.
+  absl::Status EncryptNoiseRegisters(int64_t noise_count, int value_count,
+                                     CiphertextWriter& writer);
 
  private:
-  // ElGamal cipher used to do the encryption
-  std::unique_ptr<CommutativeElGamal> el_gamal_cipher_;
+  // The id of the elliptical curve.
+  int curve_id_;
   // Context used for storing temporary values to be reused across openssl
   // function calls for better performance.
   std::unique_ptr<Context> ctx_;
   // The EC Group representing the curve definition.
   std::unique_ptr<ECGroup> ec_group_;
+  // The public key (g, y) used to do the encryption, decoded in ec_group_.
+  std::unique_ptr<ECPoint> g_;
+  std::unique_ptr<ECPoint> y_;
   // The max distinguishable counter value, all greater values are encrypted as
   // this max_counter_value_+1.
   size_t max_counter_value_;
   // A cache storing the mapping of integers to their corresponding ECPoints.
   // Once a new integer is mapped to the curve, we store the value for future
-  // reference.
-  absl::flat_hash_map<uint64_t, std::string> integer_to_ec_point_map_;
+  // reference. The points are kept decoded, and their addresses are stable.
+  absl::node_hash_map<uint64_t, ECPoint> integer_to_ec_point_map_;
+  // Multiples of the unit point, built when the first counter point n * P
+  // with n > 1 is computed lazily. Counter values are public, so the table
+  // does not need to be constant time.
+  std::optional<FixedBaseTable> unit_table_;
+  // All the points of the map computed up front, which are decoded into the
+  // map as they are used. Null if the points are computed lazily.
+  std::shared_ptr<const CounterPoints> counter_points_;
+  // Cache of the points of register indexes. May be null.
+  std::shared_ptr<IndexPointCache> index_point_cache_;
   // The cached ECPoint representation of constant "KDestroyedRegisterKey"
-  std::string destroyed_register_key_ec_;
+  std::unique_ptr<ECPoint> destroyed_register_key_ec_;
+  // The cached ECPoint representation of constant "kPublisherNoiseRegisterId"
+  std::unique_ptr<ECPoint> publisher_noise_register_id_ec_;
+  size_t bytes_per_ciphertext_ = 0;
 
-  // Since the underlying private-join-and-computer::CommutativeElGamal is NOT
-  // thread safe, we use mutex to enforce thread safety in this class.
-  absl::Mutex mutex_;
-
-  // Append an encrypted register with all values equal to a provided number
-  // to the sketch.
-  absl::Status AppendEncryptedRegisterWithSameValue(
-      absl::string_view index_ec, size_t num_of_values, int n,
-      std::string& encrypted_sketch);
-  // Append an encrypted destroyed register with all values equal to the
+  // Write an encrypted register with all values equal to a provided number.
+  absl::Status AppendEncryptedRegisterWithSameValue(const ECPoint& index_ec,
+                                                    size_t num_of_values,
+                                                    int n,
+                                                    CiphertextWriter& writer);
+  // Write an encrypted destroyed register with all values equal to the
   // encryption of the KDestroyedRegisterKey constant.
-  absl::Status AppendFlaggedDestroyedRegister(absl::string_view index_ec,
+  absl::Status AppendFlaggedDestroyedRegister(const ECPoint& index_ec,
                                               size_t num_of_values,
-                                              std::string& encrypted_sketch);
+                                              CiphertextWriter& writer);
   // Encrypt a destroyed register by inserting a pair of registers with the
   // same actual index but different values.
   absl::Status EncryptDestroyedRegister(
       const Sketch::Register& reg,
       DestroyedRegisterStrategy destroyed_register_strategy,
-      std::string& encrypted_sketch);
+      CiphertextWriter& writer);
   // Encrypt a non-destroyed register according to the exact values.
   absl::Status EncryptNonDestroyedRegister(const Sketch::Register& reg,
                                            const SketchConfig& sketch_config,
-                                           std::string& encrypted_sketch);
-  // Encrypt a Register and append the result to the encrypted_sketch.
-  absl::Status EncryptAdditionalRegister(
-      const Sketch::Register& reg, const SketchConfig& sketch_config,
-      DestroyedRegisterStrategy destroyed_register_strategy,
-      std::string& encrypted_sketch);
-  // Encrypt an ECPoint and append the result to the encrypted_sketch.
-  absl::Status EncryptAdditionalECPoint(absl::string_view ec_point,
-                                        std::string& encrypted_sketch) const;
+                                           CiphertextWriter& writer);
+  // Encrypt already decoded ECPoints of this ec_group_ one by one and write
+  // the ciphertexts to the writer in order. Taking points rather than their
+  // compressed bytes saves decompressing each plaintext before encrypting it.
+  absl::Status EncryptDecodedECPoints(
+      absl::Span<const ECPoint* const> plaintexts,
+      CiphertextWriter& writer) const;
   // Lookup the corresponding ECPoint of the input integer in the map.
   // If the ECPoint doesn't exist in the map, calculate it and insert the result
   // to the map. n can not be 0 since there is no string representation of the
   // identity element (Point At Infinity) in the ECGroup.
-  absl::StatusOr<std::string> GetECPointForInteger(uint64_t n);
-  // Hash a plaintext string to the elliptical curve and return the compressed
-  // bytes of the corresponding ECPoint.
-  absl::StatusOr<std::string> MapToCurve(absl::string_view plaintext);
-  // Hash a plaintext integer to the elliptical curve and return the compressed
-  // bytes of the corresponding ECPoint.
-  absl::StatusOr<std::string> MapToCurve(int64_t plaintext);
+  absl::StatusOr<const ECPoint*> GetECPointForInteger(uint64_t n);
+  // Compute the ECPoint nP of GetECPointForInteger.
+  absl::StatusOr<ECPoint> ComputeECPointForInteger(uint64_t n);
+  // Hash a plaintext string to the elliptical curve.
+  absl::StatusOr<ECPoint> MapToCurve(absl::string_view plaintext);
+  // Hash a plaintext integer to the elliptical curve.
+  absl::StatusOr<ECPoint> MapToCurve(int64_t plaintext);
+  // Same as MapToCurve(index), but goes through the index_point_cache_.
+  absl::StatusOr<ECPoint> MapIndexToCurve(int64_t index);
 };
 
-SketchEncrypterImpl::SketchEncrypterImpl(
-    std::unique_ptr<CommutativeElGamal> el_gamal_cipher,
-    std::unique_ptr<Context> ctx, std::unique_ptr<ECGroup> ec_group,
-    size_t max_counter_value)
-    : el_gamal_cipher_(std::move(el_gamal_cipher)),
+absl::StatusOr<std::unique_ptr<RegisterEncrypter>> RegisterEncrypter::Create(
+    int curve_id, size_t max_counter_value,
+    const CiphertextString& public_key_bytes,
+    std::shared_ptr<const CounterPoints> counter_points,
+    std::shared_ptr<IndexPointCache> index_point_cache) {
+  auto ctx = absl::make_unique<Context>();
+  ASSIGN_OR_RETURN(ECGroup temp_ec_group, ECGroup::Create(curve_id, ctx.get()));
+  auto ec_group = absl::make_unique<ECGroup>(std::move(temp_ec_group));
+  auto result = absl::make_unique<RegisterEncrypter>(
+      curve_id, std::move(ctx), std::move(ec_group), max_counter_value);
+  ASSIGN_OR_RETURN(ECPoint g,
+                   result->ec_group_->CreateECPoint(public_key_bytes.u));
+  result->g_ = absl::make_unique<ECPoint>(std::move(g));
+  ASSIGN_OR_RETURN(ECPoint y,
+                   result->ec_group_->CreateECPoint(public_key_bytes.e));
+  result->y_ = absl::make_unique<ECPoint>(std::move(y));
+  result->counter_points_ = std::move(counter_points);
+  result->index_point_cache_ = std::move(index_point_cache);
+  ASSIGN_OR_RETURN(ECPoint destroyed_register_key_ec,
+                   result->MapToCurve(KDestroyedRegisterKey));
+  // Every compressed ECPoint of the curve has the same size, so any point
+  // gives the size of the ciphertexts.
+  ASSIGN_OR_RETURN(std::string destroyed_register_key_bytes,
+                   destroyed_register_key_ec.ToBytesCompressed());
+  result->bytes_per_ciphertext_ = 2 * destroyed_register_key_bytes.size();
+  result->destroyed_register_key_ec_ =
+      absl::make_unique<ECPoint>(std::move(destroyed_register_key_ec));
+  ASSIGN_OR_RETURN(ECPoint publisher_noise_register_id_ec,
+                   result->MapToCurve(kPublisherNoiseRegisterId));
+  result->publisher_noise_register_id_ec_ =
+      absl::make_unique<ECPoint>(std::move(publisher_noise_register_id_ec));
+  return {std::move(result)};
+}
+
+RegisterEncrypter::RegisterEncrypter(
+    int curve_id, std::unique_ptr<Context> ctx,
+    std::unique_ptr<ECGroup> ec_group, size_t max_counter_value)
+    : curve_id_(curve_id),
       ctx_(std::move(ctx)),
       ec_group_(std::move(ec_group)),
       max_counter_value_(max_counter_value) {}
 
-absl::StatusOr<std::string> SketchEncrypterImpl::Encrypt(
-    const Sketch& sketch,
-    DestroyedRegisterStrategy destroyed_register_strategy) {
-  // Lock the mutex since most of the crypto computations here are NOT
-  // thread-safe.
-  absl::WriterMutexLock l(&mutex_);
-  if (!ValidateSketch(sketch)) {
-    return absl::InternalError("Sketch data doesn't match the config.");
-  }
-  const int num_registers = sketch.registers_size();
-  // number of plaintext(ciphertext) indexes and values in a
-  // plaintext(ciphertext) register.
-  const int register_size =
-      sketch.config().indexes_size() + sketch.config().values_size();
-  const int total_cipher_sketch_bytes =
-      num_registers * register_size * kBytesPerCipherText;
-  std::string encrypted_sketch;
-  encrypted_sketch.reserve(total_cipher_sketch_bytes);
-  for (auto& reg : sketch.registers()) {
-    RETURN_IF_ERROR(EncryptAdditionalRegister(
-        reg, sketch.config(), destroyed_register_strategy, encrypted_sketch));
-  }
-  return encrypted_sketch;
-}
-
-absl::Status SketchEncrypterImpl::AppendNoiseRegisters(
-    const EncryptSketchRequest::PublisherNoiseParameter&
-        publisher_noise_parameter,
-    int value_count, std::string& encrypted_sketch) {
-  // Lock the mutex since most of the crypto computations here are NOT
-  // thread-safe.
-  absl::WriterMutexLock l(&mutex_);
-
-  if (value_count < 1) {
-    return absl::InvalidArgumentError("value_count should be positive.");
-  }
-
-  DifferentialPrivacyParams params;
-  params.set_epsilon(publisher_noise_parameter.epsilon());
-  params.set_delta(publisher_noise_parameter.delta());
-
-  math::DistributedGeometricNoiseComponentOptions geometric_options =
-      math::GetGeometricPublisherNoiseOptions(
-          params, publisher_noise_parameter.publisher_count());
-  std::unique_ptr<math::DistributedNoiser> distributed_noiser =
-      std::make_unique<math::DistributedGeometricNoiser>(geometric_options);
-
-  ASSIGN_OR_RETURN(int64_t noise_count,
-                   distributed_noiser->GenerateNoiseComponent());
-
-  if (noise_count < 1) {
-    // noise_count would be at least 0.
-    // If it is 0, no need to add noise, just return.
-    return absl::OkStatus();
-  }
-
-  ASSIGN_OR_RETURN(std::string publisher_noise_register_id_ec,
-                   MapToCurve(kPublisherNoiseRegisterId));
-
-  int64_t noise_register_bytes =
-      noise_count * (value_count + 1) * kBytesPerCipherText;
-  encrypted_sketch.reserve(encrypted_sketch.size() + noise_register_bytes);
-
+absl::Status RegisterEncrypter::EncryptNoiseRegisters(
+    int64_t noise_count, int value_count, CiphertextWriter& writer) {
+  std::vector<const ECPoint*> plaintexts;
   for (int64_t i = 0; i < noise_count; ++i) {
-    // Add register id, a predefined constant.
-    RETURN_IF_ERROR(EncryptAdditionalECPoint(publisher_noise_register_id_ec,
-                                             encrypted_sketch));
     ASSIGN_OR_RETURN(
-        std::string random_value_ec,
+        ECPoint random_value_ec,
         MapToCurve(ec_group_->GeneratePrivateKey().ToDecimalString()));
-    // Add a same random value 'value_count' times.
-    for (int j = 0; j < value_count; ++j) {
-      RETURN_IF_ERROR(
-          EncryptAdditionalECPoint(random_value_ec, encrypted_sketch));
-    }
+    // Add register id, a predefined constant, and then a same random value
+    // 'value_count' times.
+    plaintexts.assign(1, publisher_noise_register_id_ec_.get());
+    plaintexts.resize(value_count + 1, &random_value_ec);
+    RETURN_IF_ERROR(EncryptDecodedECPoints(plaintexts, writer));
   }
-
   return absl::OkStatus();
 }
 
-absl::Status SketchEncrypterImpl::AppendEncryptedRegisterWithSameValue(
-    absl::string_view index_ec, size_t num_of_values, int n,
-    std::string& encrypted_sketch) {
-  RETURN_IF_ERROR(EncryptAdditionalECPoint(index_ec, encrypted_sketch));
-  ASSIGN_OR_RETURN(std::string value_ec, GetECPointForInteger(n));
-  for (size_t i = 0; i < num_of_values; ++i) {
-    RETURN_IF_ERROR(EncryptAdditionalECPoint(value_ec, encrypted_sketch));
-  }
-  return absl::OkStatus();
+absl::Status RegisterEncrypter::AppendEncryptedRegisterWithSameValue(
+    const ECPoint& index_ec, size_t num_of_values, int n,
+    CiphertextWriter& writer) {
+  ASSIGN_OR_RETURN(const ECPoint* value_ec, GetECPointForInteger(n));
+  std::vector<const ECPoint*> plaintexts(num_of_values + 1, value_ec);
+  plaintexts[0] = &index_ec;
+  return EncryptDecodedECPoints(plaintexts, writer);
 }
 
-absl::Status SketchEncrypterImpl::AppendFlaggedDestroyedRegister(
-    absl::string_view index_ec, size_t num_of_values,
-    std::string& encrypted_sketch) {
-  RETURN_IF_ERROR(EncryptAdditionalECPoint(index_ec, encrypted_sketch));
-  if (destroyed_register_key_ec_.empty()) {
-    // Do the mapping if there is no cached value.
-    ASSIGN_OR_RETURN(destroyed_register_key_ec_,
-                     MapToCurve(KDestroyedRegisterKey));
-  }
-  for (size_t i = 0; i < num_of_values; ++i) {
-    RETURN_IF_ERROR(
-        EncryptAdditionalECPoint(destroyed_register_key_ec_, encrypted_sketch));
-  }
-  return absl::OkStatus();
+absl::Status RegisterEncrypter::AppendFlaggedDestroyedRegister(
+    const ECPoint& index_ec, size_t num_of_values,
+    CiphertextWriter& writer) {
+  std::vector<const ECPoint*> plaintexts(num_of_values + 1,
+                                         destroyed_register_key_ec_.get());
+  plaintexts[0] = &index_ec;
+  return EncryptDecodedECPoints(plaintexts, writer);
 }
 
-absl::Status SketchEncrypterImpl::EncryptDestroyedRegister(
+absl::Status RegisterEncrypter::EncryptDestroyedRegister(
     const Sketch::Register& reg,
     DestroyedRegisterStrategy destroyed_register_strategy,
-    std::string& encrypted_sketch) {
-  ASSIGN_OR_RETURN(std::string index_ec, MapToCurve(reg.index()));
+    CiphertextWriter& writer) {
+  ASSIGN_OR_RETURN(ECPoint index_ec, MapIndexToCurve(reg.index()));
   switch (destroyed_register_strategy) {
     case EncryptSketchRequest::CONFLICTING_KEYS: {
       // Add two registers with the same index for a destroyed register but
       // different values.
       RETURN_IF_ERROR(AppendEncryptedRegisterWithSameValue(
-          index_ec, reg.values_size(), 1, encrypted_sketch));
+          index_ec, reg.values_size(), 1, writer));
       RETURN_IF_ERROR(AppendEncryptedRegisterWithSameValue(
-          index_ec, reg.values_size(), 2, encrypted_sketch));
+          index_ec, reg.values_size(), 2, writer));
       break;
     }
     case EncryptSketchRequest::FLAGGED_KEY: {
       // ADD one register with all values being the encryption of the
       // KDestroyedRegisterKey constant.
-      RETURN_IF_ERROR(AppendFlaggedDestroyedRegister(
-          index_ec, reg.values_size(), encrypted_sketch));
+      RETURN_IF_ERROR(
+          AppendFlaggedDestroyedRegister(index_ec, reg.values_size(), writer));
       break;
     }
     default:
@@ -314,23 +517,27 @@ absl::Status SketchEncrypterImpl::EncryptDestroyedRegister(
   return absl::OkStatus();
 }
 
-absl::Status SketchEncrypterImpl::EncryptNonDestroyedRegister(
+absl::Status RegisterEncrypter::EncryptNonDestroyedRegister(
     const Sketch::Register& reg, const SketchConfig& sketch_config,
-    std::string& encrypted_sketch) {
+    CiphertextWriter& writer) {
   // We encrypt the index as a string, since we don't need to do
   // addition on it.
-  ASSIGN_OR_RETURN(std::string index_ec, MapToCurve(reg.index()));
-  RETURN_IF_ERROR(EncryptAdditionalECPoint(index_ec, encrypted_sketch));
+  ASSIGN_OR_RETURN(ECPoint index_ec, MapIndexToCurve(reg.index()));
+  // Reserved up front, so that the plaintexts can point into it.
+  std::vector<ECPoint> unique_value_ecs;
+  unique_value_ecs.reserve(reg.values_size());
+  std::vector<const ECPoint*> plaintexts;
+  plaintexts.reserve(reg.values_size() + 1);
+  plaintexts.push_back(&index_ec);
 
   for (int i = 0; i < reg.values_size(); ++i) {
     // For values, we encrypt the value as a string if it uses UNIQUE
     // aggregator, or as an integer if it uses SUM aggregator.
     switch (sketch_config.values(i).aggregator()) {
       case SketchConfig::ValueSpec::UNIQUE: {
-        ASSIGN_OR_RETURN(std::string ec_point_string,
-                         MapToCurve(reg.values(i)));
-        RETURN_IF_ERROR(
-            EncryptAdditionalECPoint(ec_point_string, encrypted_sketch));
+        ASSIGN_OR_RETURN(ECPoint ec_point, MapToCurve(reg.values(i)));
+        unique_value_ecs.push_back(std::move(ec_point));
+        plaintexts.push_back(&unique_value_ecs.back());
         break;
       }
       case SketchConfig::ValueSpec::SUM: {
@@ -339,10 +546,9 @@ absl::Status SketchEncrypterImpl::EncryptNonDestroyedRegister(
         } else {
           // All other values are calculated based on the unit ECPoint P, which
           // is defined by KUnitECPointSeed. Integer n is mapping to nP.
-          ASSIGN_OR_RETURN(std::string ec_point_string,
+          ASSIGN_OR_RETURN(const ECPoint* ec_point,
                            GetECPointForInteger(reg.values(i)));
-          RETURN_IF_ERROR(
-              EncryptAdditionalECPoint(ec_point_string, encrypted_sketch));
+          plaintexts.push_back(ec_point);
         }
         break;
       }
@@ -351,91 +557,487 @@ absl::Status SketchEncrypterImpl::EncryptNonDestroyedRegister(
         return absl::InvalidArgumentError("Invalid Aggregator type.");
     }
   }
-  return absl::OkStatus();
+  return EncryptDecodedECPoints(plaintexts, writer);
 }
 
-absl::Status SketchEncrypterImpl::EncryptAdditionalRegister(
+absl::Status RegisterEncrypter::EncryptAdditionalRegister(
     const Sketch::Register& reg, const SketchConfig& sketch_config,
     DestroyedRegisterStrategy destroyed_register_strategy,
-    std::string& encrypted_sketch) {
+    CiphertextWriter& writer) {
   if (IsRegisterDestroyed(reg, sketch_config)) {
-    return EncryptDestroyedRegister(reg, destroyed_register_strategy,
-                                    encrypted_sketch);
+    return EncryptDestroyedRegister(reg, destroyed_register_strategy, writer);
   } else {
-    return EncryptNonDestroyedRegister(reg, sketch_config, encrypted_sketch);
+    return EncryptNonDestroyedRegister(reg, sketch_config, writer);
   }
 }
 
-absl::Status SketchEncrypterImpl::EncryptAdditionalECPoint(
-    absl::string_view ec_point, std::string& encrypted_sketch) const {
-  ASSIGN_OR_RETURN(BlindersCiphertext ciphertext,
-                   el_gamal_cipher_->Encrypt(ec_point));
-  encrypted_sketch.append(ciphertext.first);
-  encrypted_sketch.append(ciphertext.second);
+absl::Status RegisterEncrypter::EncryptDecodedECPoints(
+    absl::Span<const ECPoint* const> plaintexts,
+    CiphertextWriter& writer) const {
+  BlindersCiphertext ciphertext;
+  for (const ECPoint* plaintext : plaintexts) {
+    // (u, e) = (g^r, m * y^r) for a random r.
+    const BigNum r = ec_group_->GeneratePrivateKey();
+    ASSIGN_OR_RETURN(ECPoint u, g_->Mul(r));
+    ASSIGN_OR_RETURN(ECPoint y_to_r, y_->Mul(r));
+    ASSIGN_OR_RETURN(ECPoint e, y_to_r.Add(*plaintext));
+    ASSIGN_OR_RETURN(ciphertext.first, u.ToBytesCompressed());
+    ASSIGN_OR_RETURN(ciphertext.second, e.ToBytesCompressed());
+    if (ciphertext.first.size() + ciphertext.second.size() !=
+        bytes_per_ciphertext_) {
+      return absl::InternalError("Unexpected ciphertext size.");
+    }
+    RETURN_IF_ERROR(writer.Write(ciphertext));
+  }
   return absl::OkStatus();
 }
 
-absl::StatusOr<std::string> SketchEncrypterImpl::GetECPointForInteger(
+absl::StatusOr<const ECPoint*> RegisterEncrypter::GetECPointForInteger(
     const uint64_t n) {
   if (auto ec_point = integer_to_ec_point_map_.find(n);
       ec_point != integer_to_ec_point_map_.end()) {
-    return ec_point->second;
+    return &ec_point->second;
   }
   if (n > max_counter_value_ + 1) {
     return GetECPointForInteger(max_counter_value_ + 1);
   }
-  std::string ec_point_string;
+  ASSIGN_OR_RETURN(ECPoint ec_point, ComputeECPointForInteger(n));
+  // Update the map for future access.
+  return &integer_to_ec_point_map_.emplace(n, std::move(ec_point))
+              .first->second;
+}
+
+absl::StatusOr<ECPoint> RegisterEncrypter::ComputeECPointForInteger(
+    const uint64_t n) {
   if (n == 0) {
     // There is no string representation for 0 (ECPoint At Infinity).
     return absl::InternalError("n shouldn't be 0 for GetECPointForInteger().");
+  } else if (counter_points_ != nullptr) {
+    return ec_group_->CreateECPoint((*counter_points_)[n - 1]);
   } else if (n == 1) {
-    ASSIGN_OR_RETURN(ec_point_string, MapToCurve(KUnitECPointSeed));
+    return MapToCurve(KUnitECPointSeed);
   } else {
-    ASSIGN_OR_RETURN(ECPoint ec_1, ec_group_->GetPointByHashingToCurveSha256(
-                                       KUnitECPointSeed));
-    ASSIGN_OR_RETURN(ECPoint ec_n, ec_1.Mul(ctx_->CreateBigNum(n)));
-    ASSIGN_OR_RETURN(ec_point_string, ec_n.ToBytesCompressed());
+    if (!unit_table_.has_value()) {
+      ASSIGN_OR_RETURN(ECPoint ec_1, MapToCurve(KUnitECPointSeed));
+      ASSIGN_OR_RETURN(unit_table_,
+                       FixedBaseTable::Create(
+                           ec_1, absl::bit_width(max_counter_value_ + 1)));
+    }
+    return unit_table_->Mul(*ec_group_, ctx_->CreateBigNum(n));
   }
-  // Update the map for future access.
-  integer_to_ec_point_map_[n] = ec_point_string;
-  return {std::move(ec_point_string)};
 }
 
-absl::StatusOr<std::string> SketchEncrypterImpl::MapToCurve(
+absl::StatusOr<ECPoint> RegisterEncrypter::MapToCurve(
     absl::string_view plaintext) {
-  ASSIGN_OR_RETURN(ECPoint ec_point,
-                   ec_group_->GetPointByHashingToCurveSha256(plaintext));
-  return ec_point.ToBytesCompressed();
+  return ec_group_->GetPointByHashingToCurveSha256(plaintext);
 }
 
-absl::StatusOr<std::string> SketchEncrypterImpl::MapToCurve(int64_t plaintext) {
+absl::StatusOr<ECPoint> RegisterEncrypter::MapToCurve(int64_t plaintext) {
   return MapToCurve(std::to_string(plaintext));
 }
 
+absl::StatusOr<ECPoint> RegisterEncrypter::MapIndexToCurve(int64_t index) {
+  if (index_point_cache_ == nullptr) {
+    return MapToCurve(index);
+  }
+  if (std::optional<std::string> index_ec_bytes =
+          index_point_cache_->Lookup(curve_id_, index);
+      index_ec_bytes.has_value()) {
+    return ec_group_->CreateECPoint(*index_ec_bytes);
+  }
+  ASSIGN_OR_RETURN(ECPoint index_ec, MapToCurve(index));
+  ASSIGN_OR_RETURN(std::string index_ec_bytes, index_ec.ToBytesCompressed());
+  index_point_cache_->Insert(curve_id_, index, index_ec_bytes);
+  return {std::move(index_ec)};
+}
+
+// Add ElGamal Encryption to plaintext sketch word by word using the same public
+// key. The registers are split into one contiguous range per RegisterEncrypter,
+// and the ranges are encrypted concurrently.
+class SketchEncrypterImpl : public SketchEncrypter {
+ public:
+  explicit SketchEncrypterImpl(
+      std::vector<std::unique_ptr<RegisterEncrypter>> register_encrypters);
+  ~SketchEncrypterImpl() override = default;
+  SketchEncrypterImpl(SketchEncrypterImpl&& other) = delete;
+  SketchEncrypterImpl& operator=(SketchEncrypterImpl&& other) = delete;
+  SketchEncrypterImpl(const SketchEncrypterImpl&) = delete;
+  SketchEncrypterImpl& operator=(const SketchEncrypterImpl&) = delete;
+
+  absl::StatusOr<std::string> Encrypt(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy) override;
+
+  absl::StatusOr<size_t> Encrypt(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter,
+      absl::Span<char> buffer) override;
+
+  absl::Status AppendNoiseRegisters(
+      const EncryptSketchRequest::PublisherNoiseParameter&
+          publisher_noise_parameter,
+      int value_count, std::string& encrypted_sketch) override;
+
+  absl::Status EncryptToStream(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter,
+      absl::FunctionRef<absl::Status(size_t)> on_encrypted_size,
+      google::protobuf::io::ZeroCopyOutputStream* output) override;
+
+  absl::StatusOr<size_t> EstimateEncryptedSize(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter) const override;
+
+  int curve_id() const override {
+    return register_encrypters_.front()->curve_id();
+  }
+
+  size_t bytes_per_ciphertext() const override {
+    return register_encrypters_.front()->bytes_per_ciphertext();
+  }
+
+ private:
+  // Returns the size of the encryption of the registers of the sketch in
+  // [begin, end).
+  absl::StatusOr<size_t> GetEncryptedRegistersSize(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy, int begin,
+      int end) const;
+  // Encrypts the registers of the sketch in [begin, end) into the front of
+  // buffer, using all the RegisterEncrypters, and returns the number of bytes
+  // written.
+  absl::StatusOr<size_t> EncryptRegisters(
+      const Sketch& sketch,
+      DestroyedRegisterStrategy destroyed_register_strategy, int begin,
+      int end, absl::Span<char> buffer);
+  // Encrypts noise_count noise registers with value_count values each into
+  // encrypted_registers, which must have their size, using all the
+  // RegisterEncrypters.
+  absl::Status EncryptNoiseRegisters(int64_t noise_count, int value_count,
+                                     absl::Span<char> encrypted_registers);
+
+  // One per thread, all created from the same public key.
+  std::vector<std::unique_ptr<RegisterEncrypter>> register_encrypters_;
+
+  // The RegisterEncrypters are NOT thread safe, so we use mutex to enforce
+  // thread safety in this class.
+  absl::Mutex mutex_;
+};
+
+SketchEncrypterImpl::SketchEncrypterImpl(
+    std::vector<std::unique_ptr<RegisterEncrypter>> register_encrypters)
+    : register_encrypters_(std::move(register_encrypters)) {}
+
+absl::StatusOr<std::string> SketchEncrypterImpl::Encrypt(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy) {
+  // Lock the mutex since most of the crypto computations here are NOT
+  // thread-safe.
+  absl::WriterMutexLock l(&mutex_);
+  if (!ValidateSketch(sketch)) {
+    return absl::InternalError("Sketch data doesn't match the config.");
+  }
+  const int num_registers = sketch.registers_size();
+  ASSIGN_OR_RETURN(size_t encrypted_size,
+                   GetEncryptedRegistersSize(
+                       sketch, destroyed_register_strategy, 0, num_registers));
+  std::string encrypted_sketch(encrypted_size, '\0');
+  RETURN_IF_ERROR(EncryptRegisters(sketch, destroyed_register_strategy, 0,
+                                   num_registers,
+                                   absl::MakeSpan(encrypted_sketch))
+                      .status());
+  return encrypted_sketch;
+}
+
+absl::StatusOr<size_t> SketchEncrypterImpl::Encrypt(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy,
+    const EncryptSketchRequest::PublisherNoiseParameter*
+        publisher_noise_parameter,
+    absl::Span<char> buffer) {
+  // Lock the mutex since most of the crypto computations here are NOT
+  // thread-safe.
+  absl::WriterMutexLock l(&mutex_);
+  if (!ValidateSketch(sketch)) {
+    return absl::InternalError("Sketch data doesn't match the config.");
+  }
+  const int value_count = sketch.config().values_size();
+  if (publisher_noise_parameter != nullptr && value_count < 1) {
+    return absl::InvalidArgumentError("value_count should be positive.");
+  }
+  ASSIGN_OR_RETURN(
+      size_t sketch_size,
+      EncryptRegisters(sketch, destroyed_register_strategy, 0,
+                       sketch.registers_size(), buffer));
+  if (publisher_noise_parameter == nullptr) {
+    return sketch_size;
+  }
+  ASSIGN_OR_RETURN(int64_t noise_count,
+                   GenerateNoiseCount(*publisher_noise_parameter));
+  if (noise_count < 1) {
+    return sketch_size;
+  }
+  const size_t noise_size =
+      noise_count * (value_count + 1) * bytes_per_ciphertext();
+  if (noise_size > buffer.size() - sketch_size) {
+    return absl::InvalidArgumentError(
+        "The buffer is smaller than the encrypted sketch.");
+  }
+  RETURN_IF_ERROR(EncryptNoiseRegisters(
+      noise_count, value_count, buffer.subspan(sketch_size, noise_size)));
+  return sketch_size + noise_size;
+}
+
+absl::StatusOr<size_t> SketchEncrypterImpl::GetEncryptedRegistersSize(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy, int begin,
+    int end) const {
+  size_t encrypted_size = 0;
+  for (int i = begin; i < end; ++i) {
+    ASSIGN_OR_RETURN(int ciphertext_count,
+                     GetRegisterCiphertextCount(sketch.registers(i),
+                                                sketch.config(),
+                                                destroyed_register_strategy));
+    encrypted_size += ciphertext_count * bytes_per_ciphertext();
+  }
+  return encrypted_size;
+}
+
+absl::StatusOr<size_t> SketchEncrypterImpl::EncryptRegisters(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy, int begin, int end,
+    absl::Span<char> buffer) {
+  const int num_registers = end - begin;
+  const int num_threads = register_encrypters_.size();
+  const int num_ranges = std::max(1, std::min(num_threads, num_registers));
+  const int range_size = (num_registers + num_ranges - 1) / num_ranges;
+
+  // Size the ranges up front, so that each one is encrypted straight into its
+  // own slice of the buffer.
+  std::vector<size_t> range_offsets(num_ranges + 1, 0);
+  for (int i = 0; i < num_registers; ++i) {
+    ASSIGN_OR_RETURN(
+        int ciphertext_count,
+        GetRegisterCiphertextCount(sketch.registers(begin + i),
+                                   sketch.config(),
+                                   destroyed_register_strategy));
+    range_offsets[i / range_size + 1] +=
+        ciphertext_count * bytes_per_ciphertext();
+  }
+  std::partial_sum(range_offsets.begin(), range_offsets.end(),
+                   range_offsets.begin());
+  if (range_offsets.back() > buffer.size()) {
+    return absl::InvalidArgumentError(
+        "The buffer is smaller than the encrypted sketch.");
+  }
+
+  RETURN_IF_ERROR(
+      ParallelFor(num_ranges, num_ranges, [&](int range) -> absl::Status {
+        RegisterEncrypter& register_encrypter = *register_encrypters_[range];
+        CiphertextWriter writer(buffer.subspan(
+            range_offsets[range],
+            range_offsets[range + 1] - range_offsets[range]));
+        const int range_end = std::min(num_registers, (range + 1) * range_size);
+        for (int i = range * range_size; i < range_end; ++i) {
+          RETURN_IF_ERROR(register_encrypter.EncryptAdditionalRegister(
+              sketch.registers(begin + i), sketch.config(),
+              destroyed_register_strategy, writer));
+        }
+        return absl::OkStatus();
+      }));
+  return range_offsets.back();
+}
+
+absl::Status SketchEncrypterImpl::EncryptNoiseRegisters(
+    int64_t noise_count, int value_count,
+    absl::Span<char> encrypted_registers) {
+  if (noise_count < 1) {
+    return absl::OkStatus();
+  }
+  const int num_threads = register_encrypters_.size();
+  const int64_t range_size = (noise_count + num_threads - 1) / num_threads;
+  const int num_ranges = (noise_count + range_size - 1) / range_size;
+  const size_t bytes_per_register = (value_count + 1) * bytes_per_ciphertext();
+  return ParallelFor(num_ranges, num_ranges, [&](int range) -> absl::Status {
+    const int64_t begin = range * range_size;
+    const int64_t count = std::min(noise_count, begin + range_size) - begin;
+    CiphertextWriter writer(encrypted_registers.subspan(
+        begin * bytes_per_register, count * bytes_per_register));
+    return register_encrypters_[range]->EncryptNoiseRegisters(
+        count, value_count, writer);
+  });
+}
+
+absl::Status SketchEncrypterImpl::AppendNoiseRegisters(
+    const EncryptSketchRequest::PublisherNoiseParameter&
+        publisher_noise_parameter,
+    int value_count, std::string& encrypted_sketch) {
+  // Lock the mutex since most of the crypto computations here are NOT
+  // thread-safe.
+  absl::WriterMutexLock l(&mutex_);
+
+  if (value_count < 1) {
+    return absl::InvalidArgumentError("value_count should be positive.");
+  }
+
+  ASSIGN_OR_RETURN(int64_t noise_count,
+                   GenerateNoiseCount(publisher_noise_parameter));
+
+  if (noise_count < 1) {
+    // noise_count would be at least 0.
+    // If it is 0, no need to add noise, just return.
+    return absl::OkStatus();
+  }
+
+  const size_t sketch_size = encrypted_sketch.size();
+  const size_t noise_size =
+      noise_count * (value_count + 1) * bytes_per_ciphertext();
+  encrypted_sketch.resize(sketch_size + noise_size);
+  absl::Status status = EncryptNoiseRegisters(
+      noise_count, value_count,
+      absl::MakeSpan(encrypted_sketch).subspan(sketch_size));
+  if (!status.ok()) {
+    encrypted_sketch.resize(sketch_size);
+  }
+  return status;
+}
+
+absl::Status SketchEncrypterImpl::EncryptToStream(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy,
+    const EncryptSketchRequest::PublisherNoiseParameter*
+        publisher_noise_parameter,
+    absl::FunctionRef<absl::Status(size_t)> on_encrypted_size,
+    google::protobuf::io::ZeroCopyOutputStream* output) {
+  // Lock the mutex since most of the crypto computations here are NOT
+  // thread-safe.
+  absl::WriterMutexLock l(&mutex_);
+  if (!ValidateSketch(sketch)) {
+    return absl::InternalError("Sketch data doesn't match the config.");
+  }
+  const int num_registers = sketch.registers_size();
+  ASSIGN_OR_RETURN(size_t encrypted_size,
+                   GetEncryptedRegistersSize(
+                       sketch, destroyed_register_strategy, 0, num_registers));
+  const int value_count = sketch.config().values_size();
+  int64_t noise_count = 0;
+  if (publisher_noise_parameter != nullptr) {
+    if (value_count < 1) {
+      return absl::InvalidArgumentError("value_count should be positive.");
+    }
+    ASSIGN_OR_RETURN(noise_count,
+                     GenerateNoiseCount(*publisher_noise_parameter));
+    noise_count = std::max<int64_t>(noise_count, 0);
+    encrypted_size += noise_count * (value_count + 1) * bytes_per_ciphertext();
+  }
+  RETURN_IF_ERROR(on_encrypted_size(encrypted_size));
+
+  CodedOutputStream stream(output);
+  std::string chunk;
+  for (int begin = 0; begin < num_registers;
+       begin += kRegistersPerStreamChunk) {
+    const int end =
+        begin + std::min(num_registers - begin, kRegistersPerStreamChunk);
+    ASSIGN_OR_RETURN(size_t chunk_size,
+                     GetEncryptedRegistersSize(
+                         sketch, destroyed_register_strategy, begin, end));
+    chunk.resize(chunk_size);
+    RETURN_IF_ERROR(EncryptRegisters(sketch, destroyed_register_strategy,
+                                     begin, end, absl::MakeSpan(chunk))
+                        .status());
+    stream.WriteRaw(chunk.data(), chunk.size());
+  }
+  for (int64_t begin = 0; begin < noise_count;
+       begin += kRegistersPerStreamChunk) {
+    const int64_t count =
+        std::min<int64_t>(noise_count - begin, kRegistersPerStreamChunk);
+    chunk.resize(count * (value_count + 1) * bytes_per_ciphertext());
+    RETURN_IF_ERROR(
+        EncryptNoiseRegisters(count, value_count, absl::MakeSpan(chunk)));
+    stream.WriteRaw(chunk.data(), chunk.size());
+  }
+  stream.Trim();
+  if (stream.HadError()) {
+    return absl::DataLossError(
+        "Failed to write the encrypted sketch to the output");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<size_t> SketchEncrypterImpl::EstimateEncryptedSize(
+    const Sketch& sketch,
+    DestroyedRegisterStrategy destroyed_register_strategy,
+    const EncryptSketchRequest::PublisherNoiseParameter*
+        publisher_noise_parameter) const {
+  if (!ValidateSketch(sketch)) {
+    return absl::InternalError("Sketch data doesn't match the config.");
+  }
+  ASSIGN_OR_RETURN(
+      size_t encrypted_size,
+      GetEncryptedRegistersSize(sketch, destroyed_register_strategy, 0,
+                                sketch.registers_size()));
+  if (publisher_noise_parameter != nullptr) {
+    const int value_count = sketch.config().values_size();
+    if (value_count < 1) {
+      return absl::InvalidArgumentError("value_count should be positive.");
+    }
+    ASSIGN_OR_RETURN(int64_t max_noise_count,
+                     GetMaxNoiseCount(*publisher_noise_parameter));
+    encrypted_size +=
+        max_noise_count * (value_count + 1) * bytes_per_ciphertext();
+  }
+  return encrypted_size;
+}
+
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<SketchEncrypter>> CreateWithPublicKey(
     int curve_id, size_t max_counter_value,
-    const CiphertextString& public_key_bytes) {
-  auto ctx = absl::make_unique<Context>();
-  ASSIGN_OR_RETURN(ECGroup temp_ec_group, ECGroup::Create(curve_id, ctx.get()));
-  auto ec_group = absl::make_unique<ECGroup>(std::move(temp_ec_group));
-  ASSIGN_OR_RETURN(
-      auto el_gamal_cipher,
-      CommutativeElGamal::CreateFromPublicKey(
-          curve_id, std::make_pair(public_key_bytes.u, public_key_bytes.e)));
+    const CiphertextString& public_key_bytes,
+    const SketchEncrypterOptions& options) {
+  if (options.num_threads < 1) {
+    return absl::InvalidArgumentError("num_threads should be positive.");
+  }
+  if (options.precompute_counter_points &&
+      max_counter_value > kMaxPrecomputedCounterValue) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Counter points can only be precomputed up to a "
+                     "max_counter_value of ",
+                     kMaxPrecomputedCounterValue));
+  }
+  std::shared_ptr<const CounterPoints> counter_points;
+  if (options.precompute_counter_points) {
+    ASSIGN_OR_RETURN(counter_points,
+                     GetSharedCounterPoints(curve_id, max_counter_value));
+  }
+  std::vector<std::unique_ptr<RegisterEncrypter>> register_encrypters;
+  register_encrypters.reserve(options.num_threads);
+  for (int i = 0; i < options.num_threads; ++i) {
+    ASSIGN_OR_RETURN(std::unique_ptr<RegisterEncrypter> register_encrypter,
+                     RegisterEncrypter::Create(
+                         curve_id, max_counter_value, public_key_bytes,
+                         counter_points, options.index_point_cache));
+    register_encrypters.push_back(std::move(register_encrypter));
+  }
   std::unique_ptr<SketchEncrypter> result =
-      absl::make_unique<SketchEncrypterImpl>(
-          std::move(el_gamal_cipher), std::move(ctx), std::move(ec_group),
-          max_counter_value);
+      absl::make_unique<SketchEncrypterImpl>(std::move(register_encrypters));
   return {std::move(result)};
 }
 
 absl::StatusOr<ElGamalPublicKey> CombineElGamalPublicKeys(
-    int curve_id, const std::vector<ElGamalPublicKey>& keys) {
+    int curve_id, const std::vector<ElGamalPublicKey>& keys, int num_threads) {
   if (keys.empty()) {
     return absl::InvalidArgumentError("Keys cannot be empty");
   }
+  if (num_threads < 1) {
+    return absl::InvalidArgumentError("num_threads should be positive.");
+  }
   if (keys.size() == 1) {
     return keys[0];
   }
@@ -443,26 +1045,62 @@ absl::StatusOr<ElGamalPublicKey> CombineElGamalPublicKeys(
   ElGamalPublicKey result;
   result.set_generator(keys[0].generator());
 
-  Context ctx;
-  ASSIGN_OR_RETURN_ERROR(ECGroup ec_group, ECGroup::Create(curve_id, &ctx),
-                         absl::StrCat("Invalid Curve_id: ", curve_id));
-  ASSIGN_OR_RETURN_ERROR(ECPoint combined_element_ec,
-                         ec_group.CreateECPoint(keys[0].element()),
-                         absl::StrCat("Invalid ECPoint: ", keys[0].element()));
+  // Every range of keys is decoded and summed on its own thread, and the
+  // partial sums are then summed on this one. The CurveGroup of a range is
+  // kept until then, as its partial sum belongs to it.
+  const int num_keys = keys.size();
+  const int range_size = (num_keys + num_threads - 1) / num_threads;
+  const int num_ranges = (num_keys + range_size - 1) / range_size;
+  std::vector<std::unique_ptr<CurveGroup>> range_curve_groups(num_ranges);
+  std::vector<std::unique_ptr<ECPoint>> partial_sums(num_ranges);
+  RETURN_IF_ERROR(
+      ParallelFor(num_ranges, num_ranges, [&](int range) -> absl::Status {
+        ASSIGN_OR_RETURN(range_curve_groups[range],
+                         AcquireCurveGroup(curve_id));
+        const CurveGroup* curve_group = range_curve_groups[range].get();
+        std::vector<ECPoint> elements;
+        const int end = std::min(num_keys, (range + 1) * range_size);
+        elements.reserve(end - range * range_size);
+        for (int i = range * range_size; i < end; ++i) {
+          if (keys[i].generator() != result.generator()) {
+            return absl::InvalidArgumentError(
+                absl::StrCat("Generators don't match", keys[i].generator(),
+                             " vs ", result.generator()));
+          }
+          ASSIGN_OR_RETURN_ERROR(
+              ECPoint element_ec,
+              curve_group->ec_group->CreateECPoint(keys[i].element()),
+              absl::StrCat("Invalid ECPoint: ", keys[i].element()));
+          elements.push_back(std::move(element_ec));
+        }
+        ASSIGN_OR_RETURN(ECPoint partial_sum,
+                         SumECPoints(std::move(elements)));
+        partial_sums[range] =
+            absl::make_unique<ECPoint>(std::move(partial_sum));
+        return absl::OkStatus();
+      }));
 
-  for (size_t i = 1; i < keys.size(); i++) {
-    if (keys[i].generator() != result.generator()) {
-      return absl::InvalidArgumentError(
-          absl::StrCat("Generators don't match", keys[i].generator(), " vs ",
-                       result.generator()));
-    }
-    ASSIGN_OR_RETURN_ERROR(
-        ECPoint element_ec, ec_group.CreateECPoint(keys[i].element()),
-        absl::StrCat("Invalid ECPoint: ", keys[i].element()));
-    ASSIGN_OR_RETURN(combined_element_ec, combined_element_ec.Add(element_ec));
+  // The partial sums are added as points into one of the final CurveGroup,
+  // without encoding them. A partial sum may be the point at infinity, e.g.
+  // for a range holding the keys P and -P, which has no encoding.
+  ASSIGN_OR_RETURN(std::unique_ptr<CurveGroup> curve_group,
+                   AcquireCurveGroup(curve_id));
+  ASSIGN_OR_RETURN(ECPoint combined_element_ec,
+                   curve_group->ec_group->GetPointAtInfinity());
+  for (const std::unique_ptr<ECPoint>& partial_sum : partial_sums) {
+    ASSIGN_OR_RETURN(combined_element_ec,
+                     combined_element_ec.Add(*partial_sum));
+  }
+  for (std::unique_ptr<CurveGroup>& range_curve_group : range_curve_groups) {
+    ReleaseCurveGroup(std::move(range_curve_group));
+  }
+  if (combined_element_ec.IsPointAtInfinity()) {
+    return absl::InvalidArgumentError(
+        "The combined public key is the point at infinity.");
   }
   ASSIGN_OR_RETURN(*result.mutable_element(),
                    combined_element_ec.ToBytesCompressed());
+  ReleaseCurveGroup(std::move(curve_group));
   return std::move(result);
 }
 
@@ -15,11 +15,17 @@
 #ifndef SRC_MAIN_CC_ANY_SKETCH_CRYPTO_SKETCH_ENCRYPTER_H_
 #define SRC_MAIN_CC_ANY_SKETCH_CRYPTO_SKETCH_ENCRYPTER_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "any_sketch/crypto/index_point_cache.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "wfa/any_sketch/crypto/el_gamal_key.pb.h"
 #include "wfa/any_sketch/crypto/sketch_encryption_methods.pb.h"
 #include "wfa/any_sketch/sketch.pb.h"
@@ -50,15 +56,81 @@ class SketchEncrypter {
       EncryptSketchRequest::DestroyedRegisterStrategy
           destroyed_register_strategy) = 0;
 
+  // Same as Encrypt, followed by AppendNoiseRegisters with the value count of
+  // the sketch if publisher_noise_parameter is not null, but writes the
+  // result into the front of buffer rather than allocating it. Returns the
+  // number of bytes written, or INVALID_ARGUMENT if they do not fit, which
+  // cannot happen when buffer is at least as large as EstimateEncryptedSize.
+  virtual absl::StatusOr<size_t> Encrypt(
+      const wfa::any_sketch::Sketch& sketch,
+      EncryptSketchRequest::DestroyedRegisterStrategy
+          destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter,
+      absl::Span<char> buffer) = 0;
+
   virtual absl::Status AppendNoiseRegisters(
       const EncryptSketchRequest::PublisherNoiseParameter&
           publisher_noise_parameter,
       int value_count, std::string& encrypted_sketch) = 0;
 
+  // Same as Encrypt, followed by AppendNoiseRegisters with the value count of
+  // the sketch if publisher_noise_parameter is not null, but writes the
+  // ciphertexts to output as they are computed, so that only a bounded number
+  // of registers is held in memory. Before writing any ciphertext, calls
+  // on_encrypted_size with the number of bytes that will be written, e.g. to
+  // write a length prefix to output. On error, output may hold part of the
+  // ciphertexts.
+  virtual absl::Status EncryptToStream(
+      const wfa::any_sketch::Sketch& sketch,
+      EncryptSketchRequest::DestroyedRegisterStrategy
+          destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter,
+      absl::FunctionRef<absl::Status(size_t)> on_encrypted_size,
+      google::protobuf::io::ZeroCopyOutputStream* output) = 0;
+
+  // Returns an upper bound of the number of bytes that Encrypt writes into a
+  // buffer with the same arguments. It is exact unless there is publisher
+  // noise, whose largest possible number of registers is then assumed.
+  virtual absl::StatusOr<size_t> EstimateEncryptedSize(
+      const wfa::any_sketch::Sketch& sketch,
+      EncryptSketchRequest::DestroyedRegisterStrategy
+          destroyed_register_strategy,
+      const EncryptSketchRequest::PublisherNoiseParameter*
+          publisher_noise_parameter) const = 0;
+
+  // Returns the id of the elliptical curve of the ciphertexts.
+  virtual int curve_id() const = 0;
+
+  // Returns the number of bytes of every ciphertext, i.e. of its two
+  // compressed ECPoints.
+  virtual size_t bytes_per_ciphertext() const = 0;
+
  protected:
   SketchEncrypter() = default;
 };
 
+// Options of a SketchEncrypter.
+struct SketchEncrypterOptions {
+  // Maximum number of threads Encrypt uses. Each thread owns a separate copy
+  // of the ElGamal cipher.
+  int num_threads = 1;
+  // Whether to compute the ECPoints of all the SUM counter values up to
+  // max_counter_value + 1 on creation rather than as they are encountered.
+  // They are shared by all the SketchEncrypters with the same curve_id and
+  // max_counter_value. Requires max_counter_value <=
+  // kMaxPrecomputedCounterValue.
+  bool precompute_counter_points = false;
+  // If set, the ECPoints of register indexes are looked up in this cache before
+  // being hashed to the curve, and added to it afterwards. It may be shared by
+  // several SketchEncrypters.
+  std::shared_ptr<IndexPointCache> index_point_cache;
+};
+
+// Largest max_counter_value whose counter points can be precomputed.
+inline constexpr size_t kMaxPrecomputedCounterValue = 1 << 20;
+
 // Creates a new SketchEncrypter object using the provided parameters.
 // Returns INVALID_ARGUMENT status instead if the curve_id is not valid or
 // INTERNAL status when crypto operations are not successful.
@@ -68,13 +140,19 @@ class SketchEncrypter {
 //   max_counter_value: max decipherable counter value. Greater values are
 //     encrypted as the max_counter_value.
 //   public_key_bytes: the public key of the ElGamal cipher used for encryption.
+//   options: see SketchEncrypterOptions.
 absl::StatusOr<std::unique_ptr<SketchEncrypter>> CreateWithPublicKey(
     int curve_id, size_t max_counter_value,
-    const CiphertextString& public_key_bytes);
+    const CiphertextString& public_key_bytes,
+    const SketchEncrypterOptions& options = {});
 
 // Combine a vector of ElGamalPublicKeys whose contain the same generator.
+// The keys are decoded and summed on up to num_threads threads. The ECGroups
+// of the curve are reused across calls. Returns INVALID_ARGUMENT if the keys
+// sum to the point at infinity, whatever the number of threads.
 absl::StatusOr<ElGamalPublicKey> CombineElGamalPublicKeys(
-    int curve_id, const std::vector<ElGamalPublicKey>& keys);
+    int curve_id, const std::vector<ElGamalPublicKey>& keys,
+    int num_threads = 1);
 
 }  // namespace wfa::any_sketch::crypto
 
@@ -14,6 +14,8 @@
 
 #include "any_sketch/crypto/sketch_encrypter_adapter.h"
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -21,10 +23,22 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "any_sketch/crypto/sketch_encrypter.h"
+#include "any_sketch/crypto/sketch_encrypter_pool.h"
 #include "common_cpp/macros/macros.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "wfa/any_sketch/crypto/sketch_encryption_methods.pb.h"
 
 namespace wfa::any_sketch::crypto {
+namespace {
+using ::google::protobuf::io::CodedOutputStream;
+using ::google::protobuf::io::StringOutputStream;
+
+constexpr uint32_t kLengthDelimitedWireType = 2;
+constexpr uint32_t kEncryptedSketchTag =
+    (EncryptSketchResponse::kEncryptedSketchFieldNumber << 3) |
+    kLengthDelimitedWireType;
+}  // namespace
 
 absl::StatusOr<std::string> EncryptSketch(
     const std::string& serialized_request) {
@@ -33,25 +47,41 @@ absl::StatusOr<std::string> EncryptSketch(
     return absl::InvalidArgumentError(
         "failed to parse the EncryptSketchRequest proto.");
   }
-  ASSIGN_OR_RETURN(auto sketch_encrypter,
-                   CreateWithPublicKey(
+  // The encrypters are reused across requests under the same key.
+  ASSIGN_OR_RETURN(SketchEncrypterPool::Lease sketch_encrypter,
+                   GetSketchEncrypterPool().Acquire(
                        request_proto.curve_id(), request_proto.maximum_value(),
                        {.u = request_proto.el_gamal_keys().generator(),
                         .e = request_proto.el_gamal_keys().element()}));
 
-  EncryptSketchResponse response;
-  ASSIGN_OR_RETURN(
-      *response.mutable_encrypted_sketch(),
-      sketch_encrypter->Encrypt(request_proto.sketch(),
-                                request_proto.destroyed_register_strategy()));
-
-  if (request_proto.has_noise_parameter()) {
-    RETURN_IF_ERROR(sketch_encrypter->AppendNoiseRegisters(
-        request_proto.noise_parameter(),
-        request_proto.sketch().config().values_size(),
-        *response.mutable_encrypted_sketch()));
-  }
-  return response.SerializeAsString();
+  // The EncryptSketchResponse is serialized by hand, so that the ciphertexts
+  // are written straight into it rather than into the message first.
+  std::string response;
+  StringOutputStream output(&response);
+  RETURN_IF_ERROR(sketch_encrypter->EncryptToStream(
+      request_proto.sketch(), request_proto.destroyed_register_strategy(),
+      request_proto.has_noise_parameter() ? &request_proto.noise_parameter()
+                                          : nullptr,
+      [&](size_t encrypted_size) -> absl::Status {
+        // Empty bytes fields are not serialized.
+        if (encrypted_size == 0) {
+          return absl::OkStatus();
+        }
+        if (encrypted_size > std::numeric_limits<int32_t>::max()) {
+          return absl::InvalidArgumentError(
+              "The encrypted sketch is too large for an "
+              "EncryptSketchResponse.");
+        }
+        response.reserve(CodedOutputStream::VarintSize32(kEncryptedSketchTag) +
+                         CodedOutputStream::VarintSize64(encrypted_size) +
+                         encrypted_size);
+        CodedOutputStream stream(&output);
+        stream.WriteTag(kEncryptedSketchTag);
+        stream.WriteVarint64(encrypted_size);
+        return absl::OkStatus();
+      },
+      &output));
+  return response;
 }
 
 absl::StatusOr<std::string> CombineElGamalPublicKeys(
@@ -21,7 +21,7 @@
 
 // Wrapper methods used to generate the swig/JNI Java classes.
 // The only functionality of these methods are converting between proto messages
-// and their corresponding serialized strings, and then creating a
+// and their corresponding serialized strings, and then using a pooled
 // SketchEncrypter to encrypt the sketch.
 // Note: this method shouldn't be used in any c++ binary, use SketchEncrypter
 // directly.
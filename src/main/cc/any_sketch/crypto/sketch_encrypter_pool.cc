@@ -0,0 +1,93 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/sketch_encrypter_pool.h"
+
+#include <memory>
+#include <utility>
+
+#include "common_cpp/macros/macros.h"
+
+namespace wfa::any_sketch::crypto {
+
+void SketchEncrypterPool::Releaser::operator()(
+    SketchEncrypter* sketch_encrypter) const {
+  pool_->Release(key_, std::unique_ptr<SketchEncrypter>(sketch_encrypter));
+}
+
+SketchEncrypterPool::SketchEncrypterPool(
+    const SketchEncrypterPoolOptions& options)
+    : options_(options) {}
+
+absl::StatusOr<SketchEncrypterPool::Lease> SketchEncrypterPool::Acquire(
+    int curve_id, size_t max_counter_value,
+    const CiphertextString& public_key_bytes) {
+  Key key = {curve_id, max_counter_value, public_key_bytes.u,
+             public_key_bytes.e};
+  {
+    absl::MutexLock lock(&mutex_);
+    auto idle = idle_by_key_.find(key);
+    if (idle != idle_by_key_.end()) {
+      // Reuse the most recently released one, whose state is the warmest.
+      std::list<Entry>::iterator entry = idle->second.back();
+      std::unique_ptr<SketchEncrypter> sketch_encrypter =
+          std::move(entry->second);
+      idle_.erase(entry);
+      idle->second.pop_back();
+      if (idle->second.empty()) {
+        idle_by_key_.erase(idle);
+      }
+      return Lease(sketch_encrypter.release(), Releaser(this, std::move(key)));
+    }
+  }
+  ASSIGN_OR_RETURN(std::unique_ptr<SketchEncrypter> sketch_encrypter,
+                   CreateWithPublicKey(curve_id, max_counter_value,
+                                       public_key_bytes,
+                                       options_.encrypter_options));
+  return Lease(sketch_encrypter.release(), Releaser(this, std::move(key)));
+}
+
+size_t SketchEncrypterPool::size() const {
+  absl::MutexLock lock(&mutex_);
+  return idle_.size();
+}
+
+void SketchEncrypterPool::Release(
+    Key key, std::unique_ptr<SketchEncrypter> sketch_encrypter) {
+  if (options_.capacity == 0) {
+    return;
+  }
+  // The evicted SketchEncrypter is destroyed after the lock is released.
+  std::unique_ptr<SketchEncrypter> evicted;
+  absl::MutexLock lock(&mutex_);
+  idle_.emplace_front(key, std::move(sketch_encrypter));
+  idle_by_key_[std::move(key)].push_back(idle_.begin());
+  if (idle_.size() > options_.capacity) {
+    auto idle = idle_by_key_.find(idle_.back().first);
+    // The least recently released entry of a key is the first one.
+    idle->second.erase(idle->second.begin());
+    if (idle->second.empty()) {
+      idle_by_key_.erase(idle);
+    }
+    evicted = std::move(idle_.back().second);
+    idle_.pop_back();
+  }
+}
+
+SketchEncrypterPool& GetSketchEncrypterPool() {
+  static auto* const pool = new SketchEncrypterPool();
+  return *pool;
+}
+
+}  // namespace wfa::any_sketch::crypto
@@ -0,0 +1,109 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_CRYPTO_SKETCH_ENCRYPTER_POOL_H_
+#define SRC_MAIN_CC_ANY_SKETCH_CRYPTO_SKETCH_ENCRYPTER_POOL_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "any_sketch/crypto/sketch_encrypter.h"
+
+namespace wfa::any_sketch::crypto {
+
+// Options of a SketchEncrypterPool.
+struct SketchEncrypterPoolOptions {
+  // Maximum number of idle SketchEncrypters kept. The least recently released
+  // one is destroyed first.
+  size_t capacity = 16;
+  // Options of the SketchEncrypters the pool creates.
+  SketchEncrypterOptions encrypter_options;
+};
+
+// A bounded pool of idle SketchEncrypters, keyed by (curve_id,
+// max_counter_value, public key). Creating a SketchEncrypter sets up the
+// ElGamal cipher, and a SketchEncrypter caches the ECPoints of the counter
+// values it encrypts, so callers that encrypt many sketches under the same
+// key should reuse them. Thread-safe.
+//
+// A SketchEncrypter is not thread safe, so each one is leased to a single
+// caller at a time.
+class SketchEncrypterPool {
+ public:
+  using Key = std::tuple<int, size_t, std::string, std::string>;
+
+  // Returns a leased SketchEncrypter to its pool.
+  class Releaser {
+   public:
+    Releaser() = default;
+    void operator()(SketchEncrypter* sketch_encrypter) const;
+
+   private:
+    friend class SketchEncrypterPool;
+    Releaser(SketchEncrypterPool* pool, Key key)
+        : pool_(pool), key_(std::move(key)) {}
+
+    SketchEncrypterPool* pool_ = nullptr;
+    Key key_;
+  };
+
+  // A SketchEncrypter that goes back to the pool when it is destroyed. It must
+  // not outlive the pool.
+  using Lease = std::unique_ptr<SketchEncrypter, Releaser>;
+
+  explicit SketchEncrypterPool(const SketchEncrypterPoolOptions& options = {});
+
+  SketchEncrypterPool(SketchEncrypterPool&& other) = delete;
+  SketchEncrypterPool& operator=(SketchEncrypterPool&& other) = delete;
+  SketchEncrypterPool(const SketchEncrypterPool&) = delete;
+  SketchEncrypterPool& operator=(const SketchEncrypterPool&) = delete;
+
+  // Returns an idle SketchEncrypter with the same parameters if any, or a new
+  // one otherwise. Returns the errors of CreateWithPublicKey.
+  absl::StatusOr<Lease> Acquire(int curve_id, size_t max_counter_value,
+                                const CiphertextString& public_key_bytes);
+
+  // Number of idle SketchEncrypters.
+  size_t size() const;
+
+ private:
+  using Entry = std::pair<Key, std::unique_ptr<SketchEncrypter>>;
+
+  void Release(Key key, std::unique_ptr<SketchEncrypter> sketch_encrypter);
+
+  const SketchEncrypterPoolOptions options_;
+
+  // Guards the idle SketchEncrypters.
+  mutable absl::Mutex mutex_;
+  // Most recently released first.
+  std::list<Entry> idle_;
+  // The idle entries of every key, least recently released first.
+  absl::flat_hash_map<Key, std::vector<std::list<Entry>::iterator>>
+      idle_by_key_;
+};
+
+// Returns the process-wide SketchEncrypterPool, with the default options.
+SketchEncrypterPool& GetSketchEncrypterPool();
+
+}  // namespace wfa::any_sketch::crypto
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_CRYPTO_SKETCH_ENCRYPTER_POOL_H_
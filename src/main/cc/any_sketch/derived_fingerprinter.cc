@@ -0,0 +1,41 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/derived_fingerprinter.h"
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+
+namespace wfa::any_sketch {
+
+DerivedFingerprinter::DerivedFingerprinter(const Fingerprinter* base,
+                                           absl::string_view salt)
+    : base_(base), salt_fingerprint_(base->Fingerprint(salt)) {}
+
+uint64_t DerivedFingerprinter::Derive(uint64_t base_fingerprint) const {
+  // The finalizer of MurmurHash3, which is a bijection that spreads every bit
+  // of its input over the output, so that fingerprints derived with different
+  // salts look independent.
+  uint64_t x = base_fingerprint ^ salt_fingerprint_;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccd;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53;
+  x ^= x >> 33;
+  return x;
+}
+
+}  // namespace wfa::any_sketch
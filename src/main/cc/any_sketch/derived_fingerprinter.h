@@ -0,0 +1,51 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_DERIVED_FINGERPRINTER_H_
+#define SRC_MAIN_CC_ANY_SKETCH_DERIVED_FINGERPRINTER_H_
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+
+namespace wfa::any_sketch {
+
+// A Fingerprinter whose fingerprints are derived from those of a base
+// Fingerprinter by mixing in a salt. Distributions with different salts thus
+// only need the base fingerprint of an item, which is computed once.
+class DerivedFingerprinter : public Fingerprinter {
+ public:
+  // `base` must outlive this fingerprinter.
+  DerivedFingerprinter(const Fingerprinter* base, absl::string_view salt);
+
+  using Fingerprinter::Fingerprint;
+  uint64_t Fingerprint(absl::Span<const unsigned char> item) const override {
+    return Derive(base_->Fingerprint(item));
+  }
+
+  const Fingerprinter* base() const { return base_; }
+
+  // Returns the fingerprint of an item given its fingerprint under base().
+  uint64_t Derive(uint64_t base_fingerprint) const;
+
+ private:
+  const Fingerprinter* base_;
+  uint64_t salt_fingerprint_;
+};
+
+}  // namespace wfa::any_sketch
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_DERIVED_FINGERPRINTER_H_
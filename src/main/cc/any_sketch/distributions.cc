@@ -19,19 +19,53 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/base/macros.h"
+#include "absl/base/optimization.h"
+#include "absl/container/fixed_array.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/numeric/bits.h"
+#include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "common_cpp/fingerprinters/fingerprinters.h"
 #include "common_cpp/macros/macros.h"
 
 namespace wfa::any_sketch {
 namespace {
+// Returns the metadata of the i-th item of a batch, where an empty
+// `item_metadata` means that every item has empty metadata.
+const ItemMetadata& GetItemMetadata(
+    absl::Span<const ItemMetadata> item_metadata, size_t i) {
+  static const ItemMetadata* const kEmptyItemMetadata = new ItemMetadata();
+  return item_metadata.empty() ? *kEmptyItemMetadata : item_metadata[i];
+}
+
+absl::Status ValidateBatchSizes(absl::Span<const absl::string_view> items,
+                                absl::Span<const ItemMetadata> item_metadata,
+                                absl::Span<int64_t> values) {
+  if (!item_metadata.empty() && item_metadata.size() != items.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected metadata for ", items.size(), " items but got ",
+                     item_metadata.size()));
+  }
+  if (values.size() != items.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected space for ", items.size(),
+                     " values but got ", values.size()));
+  }
+  return absl::OkStatus();
+}
+
 class BaseDistributionImpl : public BaseDistribution {
  public:
   BaseDistributionImpl(int64_t min_value, int64_t max_value)
@@ -40,23 +74,34 @@ class BaseDistributionImpl : public BaseDistribution {
   absl::StatusOr<int64_t> Apply(
       absl::string_view item, const ItemMetadata& item_metadata) const override;
 
+  absl::Status ApplyBatch(absl::Span<const absl::string_view> items,
+                          absl::Span<const ItemMetadata> item_metadata,
+                          absl::Span<int64_t> values) const override;
+
   int64_t min_value() const override { return min_value_; }
 
   // The largest value (inclusive) that the Distribution can return.
   int64_t max_value() const override { return max_value_; }
 
+ protected:
+  absl::Status CheckRange(int64_t value) const;
+
  private:
   int64_t min_value_;
   int64_t max_value_;
 
   virtual absl::StatusOr<int64_t> ApplyInternal(
       absl::string_view item, const ItemMetadata& item_metadata) const = 0;
-};
 
-absl::StatusOr<int64_t> BaseDistributionImpl::Apply(
-    absl::string_view item, const ItemMetadata& item_metadata) const {
-  ASSIGN_OR_RETURN(int64_t value, ApplyInternal(item, item_metadata));
+  // Calculates the unchecked values for a batch of items. The default
+  // implementation calls ApplyInternal for each item.
+  virtual absl::Status ApplyInternalBatch(
+      absl::Span<const absl::string_view> items,
+      absl::Span<const ItemMetadata> item_metadata,
+      absl::Span<int64_t> values) const;
+};
 
+absl::Status BaseDistributionImpl::CheckRange(int64_t value) const {
   if (value < min_value()) {
     return absl::InvalidArgumentError(absl::StrCat(
         "Returned value ", value, " is less than minimum value ", min_value()));
@@ -66,9 +111,39 @@ absl::StatusOr<int64_t> BaseDistributionImpl::Apply(
         absl::StrCat("Returned value ", value,
                      " is greater than maximum value ", max_value()));
   }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int64_t> BaseDistributionImpl::Apply(
+    absl::string_view item, const ItemMetadata& item_metadata) const {
+  ASSIGN_OR_RETURN(int64_t value, ApplyInternal(item, item_metadata));
+  RETURN_IF_ERROR(CheckRange(value));
   return value;
 }
 
+absl::Status BaseDistributionImpl::ApplyBatch(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata,
+    absl::Span<int64_t> values) const {
+  RETURN_IF_ERROR(ValidateBatchSizes(items, item_metadata, values));
+  RETURN_IF_ERROR(ApplyInternalBatch(items, item_metadata, values));
+  for (int64_t value : values) {
+    RETURN_IF_ERROR(CheckRange(value));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BaseDistributionImpl::ApplyInternalBatch(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata,
+    absl::Span<int64_t> values) const {
+  for (size_t i = 0; i < items.size(); ++i) {
+    const ItemMetadata& metadata = GetItemMetadata(item_metadata, i);
+    ASSIGN_OR_RETURN(values[i], ApplyInternal(items[i], metadata));
+  }
+  return absl::OkStatus();
+}
+
 class OracleDistribution : public BaseDistributionImpl {
  public:
   OracleDistribution(int64_t min_value, int64_t max_value,
@@ -76,6 +151,24 @@ class OracleDistribution : public BaseDistributionImpl {
       : BaseDistributionImpl(min_value, max_value),
         feature_name_(feature_name) {}
 
+  std::optional<absl::string_view> oracle_feature_name() const override {
+    return feature_name_;
+  }
+
+  absl::Status ApplyToFeatureValues(absl::Span<const int64_t> feature_values,
+                                    absl::Span<int64_t> values) const override {
+    if (values.size() != feature_values.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected space for ", feature_values.size(),
+                       " values but got ", values.size()));
+    }
+    for (size_t i = 0; i < feature_values.size(); ++i) {
+      RETURN_IF_ERROR(CheckRange(feature_values[i]));
+      values[i] = feature_values[i];
+    }
+    return absl::OkStatus();
+  }
+
  private:
   absl::StatusOr<int64_t> ApplyInternal(
       absl::string_view item,
@@ -98,15 +191,63 @@ class FingerprintingDistribution : public BaseDistributionImpl {
       : BaseDistributionImpl(min_value, max_value),
         fingerprinter_(fingerprinter) {}
 
+  const Fingerprinter* fingerprinter() const override { return fingerprinter_; }
+
+  absl::Status ApplyToFingerprints(absl::Span<const uint64_t> fingerprints,
+                                   absl::Span<int64_t> values) const override {
+    if (values.size() != fingerprints.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected space for ", fingerprints.size(),
+                       " values but got ", values.size()));
+    }
+    MapFingerprints(fingerprints, values);
+    // Checks the whole batch with a branch-free scan and only looks for the
+    // offending value if there is one.
+    const int64_t min = min_value();
+    const int64_t max = max_value();
+    bool in_range = true;
+    for (int64_t value : values) {
+      in_range &= (value >= min) & (value <= max);
+    }
+    if (!in_range) {
+      for (int64_t value : values) {
+        RETURN_IF_ERROR(CheckRange(value));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+ protected:
+  virtual int64_t ApplyToFingerprint(uint64_t fingerprint) const = 0;
+
+  // Maps each fingerprint to its unchecked value. The default implementation
+  // calls ApplyToFingerprint for each fingerprint.
+  virtual void MapFingerprints(absl::Span<const uint64_t> fingerprints,
+                               absl::Span<int64_t> values) const {
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+      values[i] = ApplyToFingerprint(fingerprints[i]);
+    }
+  }
+
  private:
   absl::StatusOr<int64_t> ApplyInternal(
       absl::string_view item,
       const ItemMetadata& item_metadata) const override {
-    return ApplyToFingerprint(fingerprinter_->Fingerprint(item), item_metadata);
+    return ApplyToFingerprint(fingerprinter_->Fingerprint(item));
   }
 
-  virtual absl::StatusOr<int64_t> ApplyToFingerprint(
-      uint64_t fingerprint, const ItemMetadata& item_metadata) const = 0;
+  // Fingerprints the whole batch before mapping the fingerprints to values, so
+  // that each step runs as a tight loop over the batch.
+  absl::Status ApplyInternalBatch(absl::Span<const absl::string_view> items,
+                                  absl::Span<const ItemMetadata> item_metadata,
+                                  absl::Span<int64_t> values) const override {
+    absl::FixedArray<uint64_t> fingerprints(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+      fingerprints[i] = fingerprinter_->Fingerprint(items[i]);
+    }
+    MapFingerprints(fingerprints, values);
+    return absl::OkStatus();
+  }
 
   const Fingerprinter* fingerprinter_;
 };
@@ -114,13 +255,73 @@ class FingerprintingDistribution : public BaseDistributionImpl {
 class UniformDistribution : public FingerprintingDistribution {
  public:
   UniformDistribution(int64_t min_value, int64_t max_value,
-                      const Fingerprinter* fingerprinter)
-      : FingerprintingDistribution(min_value, max_value, fingerprinter) {}
+                      const Fingerprinter* fingerprinter,
+                      RangeReduction range_reduction)
+      : FingerprintingDistribution(min_value, max_value, fingerprinter),
+        size_(static_cast<uint64_t>(size())),
+        min_value_(static_cast<uint64_t>(min_value)),
+        range_reduction_(range_reduction) {
+    // Powers of two are reduced with a mask. For other sizes, precompute the
+    // reciprocal used by libdivide's branch-free unsigned division: the
+    // quotient is (((n - q) >> 1) + q) >> shift_ with q = mulhi(n, magic_).
+    if (size_ == 0 || (size_ & (size_ - 1)) == 0) {
+      return;
+    }
+    shift_ = 63 - absl::countl_zero(size_);
+    const absl::uint128 dividend = absl::uint128(1) << (64 + shift_);
+    const uint64_t quotient = absl::Uint128Low64(dividend / size_);
+    const uint64_t remainder = absl::Uint128Low64(dividend % size_);
+    const uint64_t twice_remainder = remainder + remainder;
+    magic_ = 2 * quotient + 1 +
+             (twice_remainder >= size_ || twice_remainder < remainder ? 1 : 0);
+  }
 
  private:
-  absl::StatusOr<int64_t> ApplyToFingerprint(
-      uint64_t fingerprint, const ItemMetadata& item_metadata) const override {
-    return fingerprint % size() + min_value();
+  // Values are reduced from fingerprints in uint64_t, like the original
+  // fingerprint % size() + min_value().
+  uint64_t size_;
+  uint64_t min_value_;
+  RangeReduction range_reduction_;
+  // Zero when size_ is a power of two.
+  uint64_t magic_ = 0;
+  int shift_ = 0;
+
+  uint64_t Modulo(uint64_t fingerprint) const {
+    if (magic_ == 0) {
+      return fingerprint & (size_ - 1);
+    }
+    const uint64_t q =
+        absl::Uint128High64(absl::uint128(fingerprint) * magic_);
+    const uint64_t quotient = (((fingerprint - q) >> 1) + q) >> shift_;
+    return fingerprint - quotient * size_;
+  }
+
+  uint64_t MultiplyShift(uint64_t fingerprint) const {
+    return absl::Uint128High64(absl::uint128(fingerprint) * size_);
+  }
+
+  int64_t ApplyToFingerprint(uint64_t fingerprint) const override {
+    const uint64_t offset = range_reduction_ == RangeReduction::kModulo
+                                ? Modulo(fingerprint)
+                                : MultiplyShift(fingerprint);
+    return static_cast<int64_t>(offset + min_value_);
+  }
+
+  // Picks the reduction once per batch so that each loop is branch-free.
+  void MapFingerprints(absl::Span<const uint64_t> fingerprints,
+                       absl::Span<int64_t> values) const override {
+    auto map = [&](auto reduce) {
+      for (size_t i = 0; i < fingerprints.size(); ++i) {
+        values[i] = static_cast<int64_t>(reduce(fingerprints[i]) + min_value_);
+      }
+    };
+    if (range_reduction_ == RangeReduction::kMultiplyShift) {
+      map([this](uint64_t f) { return MultiplyShift(f); });
+    } else if (magic_ == 0) {
+      map([this](uint64_t f) { return f & (size_ - 1); });
+    } else {
+      map([this](uint64_t f) { return Modulo(f); });
+    }
   }
 };
 
@@ -133,32 +334,226 @@ class ExponentialDistribution : public FingerprintingDistribution {
         exp_rate_(std::exp(rate)) {}
 
  private:
+  // Batches of at least kMinThresholdTableBatchSize fingerprints are mapped
+  // through a table of thresholds when the distribution has at most
+  // kMaxThresholdTableSize values. Smaller batches, such as those of Insert,
+  // would not pay back building the table.
+  static constexpr size_t kMinThresholdTableBatchSize = 256;
+  static constexpr int64_t kMaxThresholdTableSize = int64_t{1} << 18;
+  // Fingerprints this close to a threshold are mapped by ApplyToFingerprint,
+  // so that the table gives the same values even if std::log is not monotonic
+  // where the value changes.
+  static constexpr uint64_t kThresholdGuard = uint64_t{1} << 20;
+
+  // The value for a fingerprint is first_value plus the number of thresholds
+  // that are <= the fingerprint. The thresholds below fingerprint
+  // c << directory_shift are the first directory[c].
+  //
+  // The thresholds are stored in padded_thresholds after a 0 and are followed
+  // by kNumTrailingSentinels copies of the largest fingerprint, so that lookups
+  // can read past either end without checking. The sentinels only match
+  // fingerprints within kThresholdGuard of the ends, which are mapped by
+  // ApplyToFingerprint anyway.
+  struct ThresholdTable {
+    static constexpr size_t kNumTrailingSentinels = 3;
+
+    bool enabled = false;
+    int64_t first_value = 0;
+    std::vector<uint64_t> padded_thresholds;
+    std::vector<uint32_t> directory;
+    int directory_shift = 0;
+  };
+
   double rate_;
   double exp_rate_;
+  mutable absl::once_flag threshold_table_once_;
+  mutable std::shared_ptr<const ThresholdTable> threshold_table_;
+
+  // A ThresholdTable shared by all the distributions with the same rate and
+  // size, built once by the first of them to need it.
+  struct SharedThresholdTable {
+    absl::once_flag once;
+    ThresholdTable table;
+  };
+
+  // Returns the table of this distribution. Tables only depend on the rate and
+  // the size, so distributions with the same ones share a table while any of
+  // them holds it. The table is built outside of the lock, so that tables of
+  // other rates and sizes can be looked up or built meanwhile.
+  std::shared_ptr<const ThresholdTable> GetSharedThresholdTable() const {
+    static absl::Mutex* const mutex = new absl::Mutex();
+    static auto* const tables =
+        new absl::flat_hash_map<std::pair<double, int64_t>,
+                                std::weak_ptr<SharedThresholdTable>>();
+    std::shared_ptr<SharedThresholdTable> shared_table;
+    {
+      absl::MutexLock lock(mutex);
+      std::weak_ptr<SharedThresholdTable>& weak_table =
+          (*tables)[std::make_pair(rate_, size())];
+      shared_table = weak_table.lock();
+      if (shared_table == nullptr) {
+        shared_table = std::make_shared<SharedThresholdTable>();
+        weak_table = shared_table;
+      }
+    }
+    absl::call_once(shared_table->once, [this, &shared_table]() {
+      BuildThresholdTable(shared_table->table);
+    });
+    const ThresholdTable* table = &shared_table->table;
+    return std::shared_ptr<const ThresholdTable>(std::move(shared_table),
+                                                 table);
+  }
 
-  absl::StatusOr<int64_t> ApplyToFingerprint(
-      uint64_t fingerprint, const ItemMetadata& item_metadata) const override {
+  int64_t ApplyToFingerprint(uint64_t fingerprint) const override {
     double u = static_cast<double>(fingerprint) /
                static_cast<double>(std::numeric_limits<uint64_t>::max());
     double x = 1 - std::log(exp_rate_ + u * (1 - exp_rate_)) / rate_;
     return static_cast<int64_t>(std::floor(x * size()));
   }
-};
 
-int CountTrailingZeros(uint64_t n) {
-  if (n == 0) {
-    return 64;
+  void MapFingerprints(absl::Span<const uint64_t> fingerprints,
+                       absl::Span<int64_t> values) const override {
+    if (fingerprints.size() < kMinThresholdTableBatchSize) {
+      FingerprintingDistribution::MapFingerprints(fingerprints, values);
+      return;
+    }
+    absl::call_once(threshold_table_once_, [this]() {
+      threshold_table_ = GetSharedThresholdTable();
+    });
+    const ThresholdTable& table = *threshold_table_;
+    if (!table.enabled) {
+      FingerprintingDistribution::MapFingerprints(fingerprints, values);
+      return;
+    }
+    // thresholds[-1] is the leading 0.
+    const uint64_t* thresholds = table.padded_thresholds.data() + 1;
+    const size_t num_thresholds = table.padded_thresholds.size() -
+                                  ThresholdTable::kNumTrailingSentinels - 1;
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+      const uint64_t fingerprint = fingerprints[i];
+      // Most cells hold at most two thresholds, so comparing with the next two
+      // without branching usually finds the count.
+      size_t count = table.directory[fingerprint >> table.directory_shift];
+      count += (thresholds[count] <= fingerprint) +
+               (thresholds[count + 1] <= fingerprint);
+      if (ABSL_PREDICT_FALSE(count < num_thresholds &&
+                             thresholds[count] <= fingerprint)) {
+        count = std::upper_bound(thresholds + count,
+                                 thresholds + num_thresholds, fingerprint) -
+                thresholds;
+      }
+      const bool near_threshold =
+          (fingerprint - thresholds[count - 1] < kThresholdGuard) |
+          (thresholds[count] - fingerprint <= kThresholdGuard);
+      values[i] = ABSL_PREDICT_FALSE(near_threshold)
+                      ? ApplyToFingerprint(fingerprint)
+                      : table.first_value + static_cast<int64_t>(count);
+    }
   }
-  int c = 63;
-  n &= ~n + 1;
-  if (n & 0x00000000FFFFFFFF) c -= 32;
-  if (n & 0x0000FFFF0000FFFF) c -= 16;
-  if (n & 0x00FF00FF00FF00FF) c -= 8;
-  if (n & 0x0F0F0F0F0F0F0F0F) c -= 4;
-  if (n & 0x3333333333333333) c -= 2;
-  if (n & 0x5555555555555555) c -= 1;
-  return c;
-}
+
+  // Returns roughly the smallest fingerprint with a value of at least `value`,
+  // by inverting the formula of ApplyToFingerprint.
+  uint64_t EstimateThreshold(int64_t value) const {
+    const double x = static_cast<double>(value) / size();
+    const double u =
+        (std::exp(rate_ * (1 - x)) - exp_rate_) / (1 - exp_rate_);
+    if (!(u > 0)) {
+      return 0;
+    }
+    if (u >= 1) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(
+        u * static_cast<double>(std::numeric_limits<uint64_t>::max()));
+  }
+
+  // Returns the smallest fingerprint in (lo, hi] with a value of at least
+  // `value`, given that the value of lo is less and that of hi is not.
+  uint64_t FindThreshold(int64_t value, uint64_t lo, uint64_t hi) const {
+    // Gallop from the estimate to narrow [lo, hi] before bisecting it.
+    constexpr uint64_t kInitialStep = uint64_t{1} << 12;
+    constexpr uint64_t kMaxStep = uint64_t{1} << 62;
+    const uint64_t guess = std::clamp(EstimateThreshold(value), lo + 1, hi);
+    if (ApplyToFingerprint(guess) >= value) {
+      hi = guess;
+      for (uint64_t step = kInitialStep; step <= kMaxStep && hi - lo > step;
+           step *= 2) {
+        if (ApplyToFingerprint(hi - step) < value) {
+          lo = hi - step;
+          break;
+        }
+        hi -= step;
+      }
+    } else {
+      lo = guess;
+      for (uint64_t step = kInitialStep; step <= kMaxStep && hi - lo > step;
+           step *= 2) {
+        if (ApplyToFingerprint(lo + step) >= value) {
+          hi = lo + step;
+          break;
+        }
+        lo += step;
+      }
+    }
+    while (hi - lo > 1) {
+      const uint64_t mid = lo + (hi - lo) / 2;
+      if (ApplyToFingerprint(mid) >= value) {
+        hi = mid;
+      } else {
+        lo = mid;
+      }
+    }
+    return hi;
+  }
+
+  // Values grow with the fingerprint, so the fingerprints at which they change
+  // determine them.
+  void BuildThresholdTable(ThresholdTable& table) const {
+    constexpr uint64_t kMaxFingerprint = std::numeric_limits<uint64_t>::max();
+    const int64_t first_value = ApplyToFingerprint(0);
+    const int64_t last_value = ApplyToFingerprint(kMaxFingerprint);
+    if (!(rate_ > 0) || !std::isfinite(exp_rate_) ||
+        size() > kMaxThresholdTableSize || first_value > last_value ||
+        last_value - first_value > kMaxThresholdTableSize) {
+      return;
+    }
+    table.first_value = first_value;
+    std::vector<uint64_t>& padded_thresholds = table.padded_thresholds;
+    padded_thresholds.reserve(last_value - first_value + 1 +
+                              ThresholdTable::kNumTrailingSentinels);
+    padded_thresholds.push_back(0);
+    uint64_t previous = 0;
+    for (int64_t value = first_value + 1; value <= last_value; ++value) {
+      if (ApplyToFingerprint(previous) < value) {
+        previous = FindThreshold(value, previous, kMaxFingerprint);
+      }
+      padded_thresholds.push_back(previous);
+    }
+    const size_t num_thresholds = padded_thresholds.size() - 1;
+
+    // With at least as many cells as thresholds, a random fingerprint shares
+    // its cell with less than one threshold on average.
+    const int directory_bits =
+        std::max(1, static_cast<int>(absl::bit_width(num_thresholds)));
+    table.directory_shift = 64 - directory_bits;
+    const size_t num_cells = size_t{1} << directory_bits;
+    table.directory.resize(num_cells);
+    size_t count = 0;
+    for (size_t cell = 0; cell < num_cells; ++cell) {
+      const uint64_t cell_start = static_cast<uint64_t>(cell)
+                                  << table.directory_shift;
+      while (count < num_thresholds &&
+             padded_thresholds[count + 1] < cell_start) {
+        ++count;
+      }
+      table.directory[cell] = count;
+    }
+    padded_thresholds.insert(padded_thresholds.end(),
+                             ThresholdTable::kNumTrailingSentinels,
+                             kMaxFingerprint);
+    table.enabled = true;
+  }
+};
 
 class GeometricDistribution : public FingerprintingDistribution {
  public:
@@ -167,23 +562,155 @@ class GeometricDistribution : public FingerprintingDistribution {
       : FingerprintingDistribution(min_value, max_value, fingerprinter) {}
 
  private:
-  absl::StatusOr<int64_t> ApplyToFingerprint(
-      uint64_t fingerprint, const ItemMetadata& item_metadata) const override {
-    int trailing_zeroes = CountTrailingZeros(fingerprint);
-    return std::min(max_value(), min_value() + trailing_zeroes);
+  int64_t ApplyToFingerprint(uint64_t fingerprint) const override {
+    // absl::countr_zero(0) is 64.
+    const int trailing_zeros = absl::countr_zero(fingerprint);
+    return std::min(max_value(), min_value() + trailing_zeros);
+  }
+
+  // Has no calls or branches per fingerprint, so that it can be vectorized.
+  void MapFingerprints(absl::Span<const uint64_t> fingerprints,
+                       absl::Span<int64_t> values) const override {
+    const int64_t min = min_value();
+    const int64_t max = max_value();
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+      const int trailing_zeros = absl::countr_zero(fingerprints[i]);
+      values[i] = std::min(max, min + trailing_zeros);
+    }
+  }
+};
+
+class ConstantDistribution : public BaseDistributionImpl {
+ public:
+  explicit ConstantDistribution(int64_t value)
+      : BaseDistributionImpl(value, value) {}
+
+ private:
+  absl::StatusOr<int64_t> ApplyInternal(
+      absl::string_view item,
+      const ItemMetadata& item_metadata) const override {
+    return min_value();
+  }
+};
+
+// A distribution made of consecutive pieces of values, where each piece is
+// picked with a given probability and each value within a piece is equally
+// likely.
+//
+// The fingerprint space is split into one range per piece, sized by the
+// probability of the piece, so a fingerprint is mapped by a binary search over
+// the range boundaries and then scaled into the values of its piece.
+class PiecewiseUniformDistribution : public FingerprintingDistribution {
+ public:
+  struct Piece {
+    double weight;
+    int64_t num_values;
+  };
+
+  PiecewiseUniformDistribution(absl::Span<const Piece> pieces,
+                               const Fingerprinter* fingerprinter)
+      : FingerprintingDistribution(0, CountValues(pieces) - 1, fingerprinter),
+        upper_bounds_(pieces.size()),
+        first_values_(pieces.size()),
+        num_values_(pieces.size()) {
+    double total_weight = 0;
+    size_t last_picked = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+      if (IsPickable(pieces[i])) {
+        total_weight += pieces[i].weight;
+        last_picked = i;
+      }
+    }
+    ABSL_ASSERT(total_weight > 0);
+
+    constexpr absl::uint128 kFingerprintSpace = absl::uint128(1) << 64;
+    double cumulative_weight = 0;
+    int64_t first_value = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+      if (IsPickable(pieces[i])) {
+        cumulative_weight += pieces[i].weight;
+      }
+      const double fraction = cumulative_weight / total_weight;
+      // The last pickable piece takes what rounding leaves over, so that every
+      // fingerprint lands in a piece that holds values.
+      upper_bounds_[i] = i >= last_picked || fraction >= 1.0
+                             ? kFingerprintSpace
+                             : absl::uint128(std::ldexp(fraction, 64));
+      first_values_[i] = first_value;
+      num_values_[i] = pieces[i].num_values;
+      first_value += pieces[i].num_values;
+    }
+  }
+
+ private:
+  // Piece i is picked for fingerprints in [upper_bounds_[i - 1],
+  // upper_bounds_[i]), where the first piece starts at 0.
+  absl::FixedArray<absl::uint128> upper_bounds_;
+  absl::FixedArray<int64_t> first_values_;
+  absl::FixedArray<int64_t> num_values_;
+
+  static bool IsPickable(const Piece& piece) {
+    return piece.weight > 0 && piece.num_values > 0;
+  }
+
+  static int64_t CountValues(absl::Span<const Piece> pieces) {
+    int64_t num_values = 0;
+    for (const Piece& piece : pieces) {
+      num_values += piece.num_values;
+    }
+    return num_values;
+  }
+
+  int64_t ApplyToFingerprint(uint64_t fingerprint) const override {
+    const size_t piece =
+        std::upper_bound(upper_bounds_.begin(), upper_bounds_.end(),
+                         absl::uint128(fingerprint)) -
+        upper_bounds_.begin();
+    const absl::uint128 lower_bound =
+        piece == 0 ? absl::uint128(0) : upper_bounds_[piece - 1];
+    const absl::uint128 offset =
+        (fingerprint - lower_bound) * num_values_[piece] /
+        (upper_bounds_[piece] - lower_bound);
+    return first_values_[piece] + static_cast<int64_t>(offset);
   }
 };
 }  // namespace
 
+absl::Status BaseDistribution::ApplyBatch(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata,
+    absl::Span<int64_t> values) const {
+  RETURN_IF_ERROR(ValidateBatchSizes(items, item_metadata, values));
+  for (size_t i = 0; i < items.size(); ++i) {
+    ASSIGN_OR_RETURN(values[i],
+                     Apply(items[i], GetItemMetadata(item_metadata, i)));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BaseDistribution::ApplyToFeatureValues(
+    absl::Span<const int64_t> feature_values,
+    absl::Span<int64_t> values) const {
+  return absl::FailedPreconditionError(
+      "Distribution values are not read from a feature");
+}
+
+absl::Status BaseDistribution::ApplyToFingerprints(
+    absl::Span<const uint64_t> fingerprints, absl::Span<int64_t> values) const {
+  return absl::FailedPreconditionError(
+      "Distribution values are not determined by a fingerprint");
+}
+
 std::unique_ptr<BaseDistribution> GetOracleDistribution(
     absl::string_view feature_name, int64_t min_value, int64_t max_value) {
   return absl::make_unique<OracleDistribution>(min_value, max_value,
                                                feature_name);
 }
 std::unique_ptr<BaseDistribution> GetUniformDistribution(
-    const Fingerprinter* fingerprinter, int64_t min_value, int64_t max_value) {
+    const Fingerprinter* fingerprinter, int64_t min_value, int64_t max_value,
+    RangeReduction range_reduction) {
   return absl::make_unique<UniformDistribution>(min_value, max_value,
-                                                fingerprinter);
+                                                fingerprinter, range_reduction);
 }
 std::unique_ptr<BaseDistribution> GetExponentialDistribution(
     const Fingerprinter* fingerprinter, double rate, int64_t size) {
@@ -196,4 +723,38 @@ std::unique_ptr<BaseDistribution> GetGeometricDistribution(
   return absl::make_unique<GeometricDistribution>(min_value, max_value,
                                                   fingerprinter);
 }
+std::unique_ptr<BaseDistribution> GetConstantDistribution(int64_t value) {
+  return absl::make_unique<ConstantDistribution>(value);
+}
+std::unique_ptr<BaseDistribution> GetVerbatimDistribution(
+    const Fingerprinter* fingerprinter,
+    absl::Span<const double> probabilities) {
+  absl::FixedArray<PiecewiseUniformDistribution::Piece> pieces(
+      probabilities.size());
+  for (size_t i = 0; i < probabilities.size(); ++i) {
+    ABSL_ASSERT(probabilities[i] >= 0.0);
+    pieces[i] = {.weight = probabilities[i], .num_values = 1};
+  }
+  return absl::make_unique<PiecewiseUniformDistribution>(pieces,
+                                                         fingerprinter);
+}
+std::unique_ptr<BaseDistribution> GetDiracMixtureDistribution(
+    const Fingerprinter* fingerprinter, absl::Span<const DiracDelta> deltas,
+    int64_t num_values) {
+  ABSL_ASSERT(num_values > 0);
+  absl::FixedArray<PiecewiseUniformDistribution::Piece> pieces(deltas.size());
+  double cumulative_alpha = 0;
+  int64_t first_value = 0;
+  for (size_t i = 0; i < deltas.size(); ++i) {
+    ABSL_ASSERT(deltas[i].alpha >= 0.0);
+    ABSL_ASSERT(deltas[i].activity >= 0.0);
+    cumulative_alpha += deltas[i].alpha;
+    const int64_t end_value = std::llround(num_values * cumulative_alpha);
+    pieces[i] = {.weight = deltas[i].alpha * deltas[i].activity,
+                 .num_values = end_value - first_value};
+    first_value = end_value;
+  }
+  return absl::make_unique<PiecewiseUniformDistribution>(pieces,
+                                                         fingerprinter);
+}
 }  // namespace wfa::any_sketch
@@ -17,11 +17,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "common_cpp/fingerprinters/fingerprinters.h"
 
 namespace wfa::any_sketch {
@@ -51,19 +54,96 @@ class BaseDistribution {
   virtual absl::StatusOr<int64_t> Apply(
       absl::string_view item, const ItemMetadata& item_metadata) const = 0;
 
+  // Calculates the values of the distribution for a batch of items, writing
+  // the value for items[i] to values[i].
+  //
+  // `item_metadata` is either empty, in which case every item has empty
+  // metadata, or holds the metadata of each item. Returns the first error
+  // encountered, in which case the contents of `values` are unspecified.
+  virtual absl::Status ApplyBatch(absl::Span<const absl::string_view> items,
+                                  absl::Span<const ItemMetadata> item_metadata,
+                                  absl::Span<int64_t> values) const;
+
+  // Returns the name of the ItemMetadata feature whose value the distribution
+  // returns as is, or nullopt if it is not an OracleDistribution.
+  virtual std::optional<absl::string_view> oracle_feature_name() const {
+    return std::nullopt;
+  }
+
+  // Calculates the values of an OracleDistribution from the values of its
+  // feature, writing the value for feature_values[i] to values[i]. This gives
+  // the same values as ApplyBatch on items with those features.
+  //
+  // Returns an error if oracle_feature_name() is nullopt.
+  virtual absl::Status ApplyToFeatureValues(
+      absl::Span<const int64_t> feature_values,
+      absl::Span<int64_t> values) const;
+
+  // Returns the fingerprinter whose fingerprint of an item alone determines
+  // the value for the item, or nullptr if the value depends on more than that.
+  virtual const Fingerprinter* fingerprinter() const { return nullptr; }
+
+  // Calculates the values of the distribution for items with the given
+  // fingerprints, as computed by fingerprinter(), writing the value for
+  // fingerprints[i] to values[i]. This gives the same values as ApplyBatch on
+  // the items, but lets callers fingerprint each item once for several
+  // distributions.
+  //
+  // Returns an error if fingerprinter() is nullptr.
+  virtual absl::Status ApplyToFingerprints(
+      absl::Span<const uint64_t> fingerprints,
+      absl::Span<int64_t> values) const;
+
  protected:
   BaseDistribution() = default;
 };
 
 std::unique_ptr<BaseDistribution> GetOracleDistribution(
     absl::string_view feature_name, int64_t min_value, int64_t max_value);
+// How a uniform distribution reduces a fingerprint to one of its `size()`
+// values. The reductions give different values, so sketches can only be merged
+// if they were built with the same one.
+enum class RangeReduction {
+  // fingerprint % size(). Computed with a precomputed reciprocal instead of a
+  // division, with the same result.
+  kModulo,
+  // (fingerprint * size()) >> 64, as proposed by Lemire. Cheaper than kModulo.
+  kMultiplyShift,
+};
+
 std::unique_ptr<BaseDistribution> GetUniformDistribution(
-    const Fingerprinter* fingerprinter, int64_t min_value, int64_t max_value);
+    const Fingerprinter* fingerprinter, int64_t min_value, int64_t max_value,
+    RangeReduction range_reduction = RangeReduction::kModulo);
 std::unique_ptr<BaseDistribution> GetExponentialDistribution(
     const Fingerprinter* fingerprinter, double rate, int64_t size);
 std::unique_ptr<BaseDistribution> GetGeometricDistribution(
     const Fingerprinter* fingerprinter, int64_t min_value, int64_t max_value);
 
+// Always returns `value`.
+std::unique_ptr<BaseDistribution> GetConstantDistribution(int64_t value);
+
+// Returns i with probability proportional to probabilities[i]. The
+// probabilities must be non-negative with a positive sum.
+std::unique_ptr<BaseDistribution> GetVerbatimDistribution(
+    const Fingerprinter* fingerprinter, absl::Span<const double> probabilities);
+
+// A pool of values in a DiracMixtureDistribution.
+struct DiracDelta {
+  // Fraction of the values that the pool holds.
+  double alpha;
+  // Relative probability of each value in the pool.
+  double activity;
+};
+
+// Returns a value from the pools of `deltas`, which are laid out one after
+// another starting at 0, pool k holding about num_values * deltas[k].alpha
+// values. A pool is picked with probability proportional to alpha * activity
+// and a value uniformly within it. At least one pool must hold a value and have
+// a positive probability.
+std::unique_ptr<BaseDistribution> GetDiracMixtureDistribution(
+    const Fingerprinter* fingerprinter, absl::Span<const DiracDelta> deltas,
+    int64_t num_values);
+
 }  // namespace wfa::any_sketch
 
 #endif  // SRC_MAIN_CC_ANY_SKETCH_DISTRIBUTIONS_H_
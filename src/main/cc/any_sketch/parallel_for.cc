@@ -0,0 +1,58 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+
+namespace wfa::any_sketch {
+
+absl::Status ParallelFor(int num_threads, int n,
+                         absl::FunctionRef<absl::Status(int)> fn) {
+  std::vector<absl::Status> statuses(std::max(n, 0));
+  std::atomic<int> next_task{0};
+  auto run_tasks = [&]() {
+    for (int i = next_task++; i < n; i = next_task++) {
+      statuses[i] = fn(i);
+    }
+  };
+
+  // The calling thread works on tasks too, so only the extra threads are
+  // spawned.
+  const int num_extra_threads = std::min(num_threads, n) - 1;
+  std::vector<std::thread> threads;
+  threads.reserve(std::max(num_extra_threads, 0));
+  for (int t = 0; t < num_extra_threads; ++t) {
+    threads.emplace_back(run_tasks);
+  }
+  run_tasks();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const absl::Status& status : statuses) {
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace wfa::any_sketch
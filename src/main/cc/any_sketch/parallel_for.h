@@ -0,0 +1,34 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_PARALLEL_FOR_H_
+#define SRC_MAIN_CC_ANY_SKETCH_PARALLEL_FOR_H_
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+
+namespace wfa::any_sketch {
+
+// Calls `fn(i)` for every i in [0, n), running at most `num_threads` calls
+// concurrently on separate threads. Calls are not ordered, so `fn` must only
+// touch state that is owned by its task.
+//
+// Returns the error of the failed call with the smallest i, or OK if every call
+// succeeded. Every call runs even if an earlier one fails.
+absl::Status ParallelFor(int num_threads, int n,
+                         absl::FunctionRef<absl::Status(int)> fn);
+
+}  // namespace wfa::any_sketch
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_PARALLEL_FOR_H_
@@ -0,0 +1,165 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sharded_any_sketch_builder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/fixed_array.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/distributions.h"
+#include "any_sketch/parallel_for.h"
+#include "common_cpp/macros/macros.h"
+
+namespace wfa::any_sketch {
+namespace {
+constexpr uint64_t kIndexesPerBlock = 64;
+
+// The registers computed for a contiguous slice of a batch.
+struct Slice {
+  std::vector<int64_t> indexes;
+  // Value i of item j is stored at value_columns[i * indexes.size() + j].
+  std::vector<AnySketch::ValueType> value_columns;
+  // Positions within the slice of the items owned by each shard.
+  std::vector<std::vector<size_t>> items_by_shard;
+};
+}  // namespace
+
+ShardedAnySketchBuilder::ShardedAnySketchBuilder(int num_shards,
+                                                 SketchFactory sketch_factory)
+    : num_shards_(std::max(num_shards, 1)) {
+  sketches_.push_back(sketch_factory());
+  if (!sketches_.front()->is_dense()) {
+    for (int shard = 1; shard < num_shards_; ++shard) {
+      sketches_.push_back(sketch_factory());
+    }
+  }
+}
+
+int ShardedAnySketchBuilder::GetShard(uint64_t index) const {
+  return (index / kIndexesPerBlock) % num_shards_;
+}
+
+AnySketch& ShardedAnySketchBuilder::GetShardSketch(int shard) {
+  return sketches_.size() == 1 ? *sketches_.front() : *sketches_[shard];
+}
+
+absl::Status ShardedAnySketchBuilder::InsertBatch(
+    absl::Span<const uint64_t> items,
+    absl::Span<const ItemMetadata> item_metadata) {
+  AnySketch::EncodedItems encoded_items(items);
+  return InsertBatch(encoded_items.views(), item_metadata);
+}
+
+absl::Status ShardedAnySketchBuilder::InsertBatch(
+    absl::Span<const absl::string_view> items,
+    absl::Span<const ItemMetadata> item_metadata) {
+  if (sketches_.empty()) {
+    return absl::FailedPreconditionError("The sketch was already finalized.");
+  }
+  if (!item_metadata.empty() && item_metadata.size() != items.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected metadata for ", items.size(), " items but got ",
+                     item_metadata.size()));
+  }
+  // All sketches share one config, so any of them can compute the registers.
+  const AnySketch& config_sketch = *sketches_.front();
+  const size_t register_size = config_sketch.register_size();
+  const size_t slice_size = (items.size() + num_shards_ - 1) / num_shards_;
+
+  // Compute the registers of each slice and route them to their shards. Only
+  // const methods of the sketches run here.
+  std::vector<Slice> slices(num_shards_);
+  RETURN_IF_ERROR(ParallelFor(
+      num_shards_, num_shards_, [&](int slice_number) -> absl::Status {
+        const size_t begin = std::min(items.size(), slice_number * slice_size);
+        const size_t size = std::min(slice_size, items.size() - begin);
+        Slice& slice = slices[slice_number];
+        slice.indexes.resize(size);
+        slice.value_columns.resize(size * register_size);
+        absl::Span<const ItemMetadata> slice_metadata =
+            item_metadata.empty() ? item_metadata
+                                  : item_metadata.subspan(begin, size);
+        absl::FixedArray<int64_t> feature_columns(
+            config_sketch.feature_names().size() * size);
+        RETURN_IF_ERROR(config_sketch.GetFeatureColumns(
+            size, slice_metadata, absl::MakeSpan(feature_columns)));
+        RETURN_IF_ERROR(config_sketch.ComputeRegisters(
+            items.subspan(begin, size), slice_metadata, feature_columns,
+            absl::MakeSpan(slice.indexes),
+            absl::MakeSpan(slice.value_columns)));
+        slice.items_by_shard.resize(num_shards_);
+        for (size_t j = 0; j < size; ++j) {
+          slice.items_by_shard[GetShard(slice.indexes[j])].push_back(j);
+        }
+        return absl::OkStatus();
+      }));
+
+  // Nothing has been written so far, so a failure above leaves the sketch
+  // unchanged. Each shard now aggregates the registers it owns.
+  return ParallelFor(num_shards_, num_shards_, [&](int shard) -> absl::Status {
+    AnySketch& sketch = GetShardSketch(shard);
+    absl::FixedArray<AnySketch::ValueType> new_values(register_size);
+    for (const Slice& slice : slices) {
+      const size_t size = slice.indexes.size();
+      for (size_t j : slice.items_by_shard[shard]) {
+        for (size_t i = 0; i < register_size; ++i) {
+          new_values[i] = slice.value_columns[i * size + j];
+        }
+        RETURN_IF_ERROR(sketch.AggregateIntoRegister(slice.indexes[j],
+                                                     new_values));
+      }
+    }
+    return absl::OkStatus();
+  });
+}
+
+absl::StatusOr<std::unique_ptr<AnySketch>>
+ShardedAnySketchBuilder::Finalize() {
+  if (sketches_.empty()) {
+    return absl::FailedPreconditionError("The sketch was already finalized.");
+  }
+  std::vector<std::unique_ptr<AnySketch>> sketches = std::move(sketches_);
+  sketches_.clear();
+  if (sketches.size() == 1) {
+    return {std::move(sketches.front())};
+  }
+
+  // The shards hold disjoint registers, so concatenating them never
+  // aggregates two registers.
+  size_t num_registers = 0;
+  for (const std::unique_ptr<AnySketch>& sketch : sketches) {
+    num_registers += sketch->num_registers();
+  }
+  std::unique_ptr<AnySketch> result = std::move(sketches.front());
+  result->ReserveSparse(num_registers);
+  for (size_t shard = 1; shard < sketches.size(); ++shard) {
+    for (const AnySketch::Register& reg : *sketches[shard]) {
+      RETURN_IF_ERROR(result->AggregateIntoRegister(reg.index, reg.values));
+    }
+    sketches[shard].reset();
+  }
+  return {std::move(result)};
+}
+
+}  // namespace wfa::any_sketch
@@ -0,0 +1,93 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_SHARDED_ANY_SKETCH_BUILDER_H_
+#define SRC_MAIN_CC_ANY_SKETCH_SHARDED_ANY_SKETCH_BUILDER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/distributions.h"
+
+namespace wfa::any_sketch {
+
+// Builds an AnySketch on several threads.
+//
+// The linearized register index space is partitioned across `num_shards`
+// shards in blocks of 64 consecutive indexes, and each shard is only ever
+// written by one thread. InsertBatch computes the registers of a batch on all
+// threads, routes each register to the shard owning its index, and then lets
+// every shard aggregate its own registers. Since no two shards share a
+// register, no locks are needed.
+//
+// Dense sketches are written in place, as the shards own disjoint ranges of
+// the same register array. Sparse sketches get one sketch per shard, which
+// Finalize() concatenates.
+//
+// This class is not thread-safe: InsertBatch parallelizes internally and must
+// not be called concurrently.
+class ShardedAnySketchBuilder {
+ public:
+  // Returns a new, empty AnySketch. Every call must return a sketch with the
+  // same config.
+  using SketchFactory = std::function<std::unique_ptr<AnySketch>()>;
+
+  ShardedAnySketchBuilder(int num_shards, SketchFactory sketch_factory);
+
+  ShardedAnySketchBuilder(const ShardedAnySketchBuilder &) = delete;
+  ShardedAnySketchBuilder &operator=(const ShardedAnySketchBuilder &) = delete;
+
+  int num_shards() const { return num_shards_; }
+
+  // Adds each of `items` to the sketch, with the same result as
+  // AnySketch::InsertBatch. Batches should be large, as every call starts
+  // num_shards() threads twice.
+  //
+  // If an error is returned, the sketch is left unchanged.
+  ABSL_MUST_USE_RESULT absl::Status InsertBatch(
+      absl::Span<const uint64_t> items,
+      absl::Span<const ItemMetadata> item_metadata = {});
+  ABSL_MUST_USE_RESULT absl::Status InsertBatch(
+      absl::Span<const absl::string_view> items,
+      absl::Span<const ItemMetadata> item_metadata = {});
+
+  // Returns the sketch holding every inserted item. The builder must not be
+  // used afterwards.
+  absl::StatusOr<std::unique_ptr<AnySketch>> Finalize();
+
+ private:
+  int num_shards_;
+  // One sketch per shard for sparse sketches, or a single sketch shared by all
+  // shards for dense ones. Empty after Finalize().
+  std::vector<std::unique_ptr<AnySketch>> sketches_;
+
+  // Returns the shard owning the register with the given index. Blocks of 64
+  // indexes share a word of the dense occupancy bitmap, so they always belong
+  // to the same shard.
+  int GetShard(uint64_t index) const;
+
+  AnySketch &GetShardSketch(int shard);
+};
+
+}  // namespace wfa::any_sketch
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_SHARDED_ANY_SKETCH_BUILDER_H_
@@ -0,0 +1,232 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sketch_config.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/derived_fingerprinter.h"
+#include "any_sketch/distributions.h"
+#include "any_sketch/value_function.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/macros/macros.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+namespace {
+
+const Fingerprinter* GetFingerprinter(bool has_salt, absl::string_view salt) {
+  return has_salt ? &GetSaltedFingerprinter(salt) : &GetFarmFingerprinter();
+}
+
+absl::StatusOr<AggregatorType> GetAggregatorType(
+    SketchConfig::ValueSpec::Aggregator aggregator) {
+  switch (aggregator) {
+    case SketchConfig::ValueSpec::SUM:
+      return AggregatorType::kSum;
+    case SketchConfig::ValueSpec::UNIQUE:
+      return AggregatorType::kUnique;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported aggregator: ", aggregator));
+  }
+}
+
+absl::StatusOr<std::unique_ptr<BaseDistribution>> CreateDiracMixture(
+    const DiracMixtureDistribution& config) {
+  if (config.num_values() <= 0) {
+    return absl::InvalidArgumentError(
+        "DiracMixtureDistribution must have a positive num_values");
+  }
+  std::vector<DiracDelta> deltas;
+  deltas.reserve(config.deltas_size());
+  double cumulative_alpha = 0;
+  bool can_pick_value = false;
+  for (const DiracMixtureDistribution::DiracDelta& delta : config.deltas()) {
+    if (!(delta.alpha() >= 0) || !(delta.activity() >= 0)) {
+      return absl::InvalidArgumentError(
+          "DiracMixtureDistribution deltas must have non-negative alpha and "
+          "activity");
+    }
+    // Mirrors the pool boundaries of GetDiracMixtureDistribution.
+    const int64_t first_value =
+        std::llround(config.num_values() * cumulative_alpha);
+    cumulative_alpha += delta.alpha();
+    const int64_t end_value =
+        std::llround(config.num_values() * cumulative_alpha);
+    can_pick_value |=
+        end_value > first_value && delta.alpha() * delta.activity() > 0;
+    deltas.push_back({.alpha = delta.alpha(), .activity = delta.activity()});
+  }
+  if (!can_pick_value) {
+    return absl::InvalidArgumentError(
+        "DiracMixtureDistribution must have a non-empty delta with a positive "
+        "alpha * activity");
+  }
+  return GetDiracMixtureDistribution(&GetFarmFingerprinter(), deltas,
+                                     config.num_values());
+}
+
+absl::StatusOr<std::unique_ptr<BaseDistribution>> CreateVerbatim(
+    const VerbatimDistribution& config) {
+  double total_probability = 0;
+  for (double probability : config.index_probability()) {
+    if (!(probability >= 0)) {
+      return absl::InvalidArgumentError(
+          "VerbatimDistribution probabilities must be non-negative");
+    }
+    total_probability += probability;
+  }
+  if (!(total_probability > 0)) {
+    return absl::InvalidArgumentError(
+        "VerbatimDistribution must have a positive probability");
+  }
+  return GetVerbatimDistribution(&GetFarmFingerprinter(),
+                                 config.index_probability());
+}
+}  // namespace
+
+const DerivedFingerprinter& GetSaltedFingerprinter(absl::string_view salt) {
+  static absl::Mutex* const mutex = new absl::Mutex();
+  static auto* const fingerprinters =
+      new absl::flat_hash_map<std::string,
+                              std::unique_ptr<DerivedFingerprinter>>();
+
+  absl::MutexLock lock(mutex);
+  std::unique_ptr<DerivedFingerprinter>& fingerprinter =
+      (*fingerprinters)[salt];
+  if (fingerprinter == nullptr) {
+    fingerprinter =
+        absl::make_unique<DerivedFingerprinter>(&GetFarmFingerprinter(), salt);
+  }
+  return *fingerprinter;
+}
+
+absl::StatusOr<std::unique_ptr<BaseDistribution>> CreateDistributionFromConfig(
+    const Distribution& distribution) {
+  switch (distribution.distribution_choice_case()) {
+    case Distribution::kExponential: {
+      const ExponentialDistribution& config = distribution.exponential();
+      if (!(config.rate() > 0) || config.num_values() <= 0) {
+        return absl::InvalidArgumentError(
+            "ExponentialDistribution must have a positive rate and num_values");
+      }
+      return GetExponentialDistribution(
+          GetFingerprinter(config.has_salt(), config.salt()), config.rate(),
+          config.num_values());
+    }
+    case Distribution::kUniform: {
+      const UniformDistribution& config = distribution.uniform();
+      if (config.num_values() <= 0) {
+        return absl::InvalidArgumentError(
+            "UniformDistribution must have a positive num_values");
+      }
+      RangeReduction range_reduction;
+      switch (config.range_reduction()) {
+        case UniformDistribution::MODULO:
+          range_reduction = RangeReduction::kModulo;
+          break;
+        case UniformDistribution::MULTIPLY_SHIFT:
+          range_reduction = RangeReduction::kMultiplyShift;
+          break;
+        default:
+          return absl::InvalidArgumentError(
+              absl::StrCat("Unsupported UniformDistribution range_reduction ",
+                           config.range_reduction()));
+      }
+      return GetUniformDistribution(
+          GetFingerprinter(config.has_salt(), config.salt()), 0,
+          config.num_values() - 1, range_reduction);
+    }
+    case Distribution::kGeometric: {
+      const GeometricDistribution& config = distribution.geometric();
+      // Values are derived from the trailing zeros of the fingerprint, each of
+      // which is set with probability 1/2.
+      if (config.success_probability() != 0.5) {
+        return absl::UnimplementedError(
+            "GeometricDistribution only supports a success_probability of 0.5");
+      }
+      if (config.num_values() <= 0) {
+        return absl::InvalidArgumentError(
+            "GeometricDistribution must have a positive num_values");
+      }
+      return GetGeometricDistribution(
+          GetFingerprinter(config.has_salt(), config.salt()), 0,
+          config.num_values() - 1);
+    }
+    case Distribution::kConstant:
+      return GetConstantDistribution(distribution.constant().value());
+    case Distribution::kDiracMixture:
+      return CreateDiracMixture(distribution.dirac_mixture());
+    case Distribution::kVerbatim:
+      return CreateVerbatim(distribution.verbatim());
+    case Distribution::kOracle:
+      // The largest value is one less than the maximum so that size() does
+      // not overflow.
+      return GetOracleDistribution(distribution.oracle().key(), 0,
+                                   std::numeric_limits<int64_t>::max() - 1);
+    case Distribution::DISTRIBUTION_CHOICE_NOT_SET:
+      break;
+  }
+  return absl::InvalidArgumentError("Distribution is not set");
+}
+
+absl::StatusOr<std::unique_ptr<AnySketch>> CreateAnySketchFromConfig(
+    const SketchConfig& config, const AnySketchOptions& options) {
+  if (config.sketch_type() != SketchConfig::GENERIC) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported sketch type: ", config.sketch_type()));
+  }
+
+  std::vector<std::unique_ptr<BaseDistribution>> indexes;
+  indexes.reserve(config.indexes_size());
+  for (const SketchConfig::IndexSpec& index_spec : config.indexes()) {
+    ASSIGN_OR_RETURN(std::unique_ptr<BaseDistribution> distribution,
+                     CreateDistributionFromConfig(index_spec.distribution()));
+    indexes.push_back(std::move(distribution));
+  }
+
+  std::vector<ValueFunction> values;
+  values.reserve(config.values_size());
+  for (const SketchConfig::ValueSpec& value_spec : config.values()) {
+    ASSIGN_OR_RETURN(std::unique_ptr<BaseDistribution> distribution,
+                     CreateDistributionFromConfig(value_spec.distribution()));
+    ASSIGN_OR_RETURN(AggregatorType aggregator_type,
+                     GetAggregatorType(value_spec.aggregator()));
+    values.push_back({.name = value_spec.name(),
+                      .aggregator_type = aggregator_type,
+                      .distribution = std::move(distribution)});
+  }
+
+  return absl::make_unique<AnySketch>(std::move(indexes), std::move(values),
+                                      options);
+}
+
+}  // namespace wfa::any_sketch
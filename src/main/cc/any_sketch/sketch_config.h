@@ -0,0 +1,51 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_SKETCH_CONFIG_H_
+#define SRC_MAIN_CC_ANY_SKETCH_SKETCH_CONFIG_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/derived_fingerprinter.h"
+#include "any_sketch/distributions.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+
+// Creates an empty AnySketch with the indexes and values described by
+// `config`.
+//
+// Distributions without a salt fingerprint items with the Farm fingerprinter.
+// Those with a salt use GetSaltedFingerprinter, so index and value specs with
+// the same salt share a fingerprinter. Oracle distributions accept any
+// non-negative value, as SketchConfig does not bound them.
+absl::StatusOr<std::unique_ptr<AnySketch>> CreateAnySketchFromConfig(
+    const SketchConfig& config, const AnySketchOptions& options = {});
+
+// Creates the distribution described by `distribution`.
+absl::StatusOr<std::unique_ptr<BaseDistribution>> CreateDistributionFromConfig(
+    const Distribution& distribution);
+
+// Returns a fingerprinter that mixes `salt` into the Farm fingerprint of an
+// item. Fingerprinters are created once per salt and live for the rest of the
+// process.
+const DerivedFingerprinter& GetSaltedFingerprinter(absl::string_view salt);
+
+}  // namespace wfa::any_sketch
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_SKETCH_CONFIG_H_
@@ -0,0 +1,146 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sketch_proto_conversion.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/container/fixed_array.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/value_function.h"
+#include "common_cpp/macros/macros.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+namespace {
+using ::google::protobuf::io::CodedOutputStream;
+
+constexpr uint32_t kVarintWireType = 0;
+constexpr uint32_t kLengthDelimitedWireType = 2;
+
+constexpr uint32_t MakeTag(int field_number, uint32_t wire_type) {
+  return (static_cast<uint32_t>(field_number) << 3) | wire_type;
+}
+
+constexpr uint32_t kRegistersTag =
+    MakeTag(Sketch::kRegistersFieldNumber, kLengthDelimitedWireType);
+constexpr uint32_t kIndexTag =
+    MakeTag(Sketch::Register::kIndexFieldNumber, kVarintWireType);
+constexpr uint32_t kValuesTag =
+    MakeTag(Sketch::Register::kValuesFieldNumber, kLengthDelimitedWireType);
+
+// Returns the Aggregator of each value of the registers of `sketch`.
+absl::FixedArray<const Aggregator*> GetAggregators(const AnySketch& sketch) {
+  absl::Span<const ValueFunction> value_functions = sketch.value_functions();
+  absl::FixedArray<const Aggregator*> aggregators(value_functions.size());
+  for (size_t i = 0; i < value_functions.size(); ++i) {
+    aggregators[i] = &GetAggregator(value_functions[i].aggregator_type);
+  }
+  return aggregators;
+}
+}  // namespace
+
+void ToProto(const AnySketch& sketch, Sketch* sketch_proto) {
+  absl::FixedArray<const Aggregator*> aggregators = GetAggregators(sketch);
+  auto* registers = sketch_proto->mutable_registers();
+  registers->Clear();
+  registers->Reserve(sketch.num_registers());
+  for (const AnySketch::Register& reg : sketch) {
+    Sketch::Register* register_proto = registers->Add();
+    register_proto->set_index(reg.index);
+    auto* values = register_proto->mutable_values();
+    values->Reserve(reg.values.size());
+    for (size_t i = 0; i < reg.values.size(); ++i) {
+      values->AddAlreadyReserved(
+          aggregators[i]->EncodeToProtoValue(reg.values[i]));
+    }
+  }
+}
+
+absl::Status FromProto(const Sketch& sketch_proto, AnySketch* sketch) {
+  absl::FixedArray<const Aggregator*> aggregators = GetAggregators(*sketch);
+  absl::FixedArray<int64_t> values(aggregators.size());
+  for (const Sketch::Register& register_proto : sketch_proto.registers()) {
+    if (static_cast<size_t>(register_proto.values_size()) !=
+        aggregators.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Register ", register_proto.index(), " has ",
+          register_proto.values_size(), " values but the sketch expects ",
+          aggregators.size()));
+    }
+    for (size_t i = 0; i < aggregators.size(); ++i) {
+      values[i] =
+          aggregators[i]->DecodeFromProtoValue(register_proto.values(i));
+    }
+    RETURN_IF_ERROR(
+        sketch->AggregateIntoRegister(register_proto.index(), values));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status WriteSketchProto(
+    const AnySketch& sketch,
+    google::protobuf::io::ZeroCopyOutputStream* output) {
+  absl::FixedArray<const Aggregator*> aggregators = GetAggregators(sketch);
+  absl::FixedArray<uint64_t> encoded_values(aggregators.size());
+  CodedOutputStream stream(output);
+  for (const AnySketch::Register& reg : sketch) {
+    // Mirrors the proto3 serialization of Sketch::Register: the index is
+    // omitted when it is 0 and the values are packed.
+    size_t values_size = 0;
+    for (size_t i = 0; i < reg.values.size(); ++i) {
+      encoded_values[i] = static_cast<uint64_t>(
+          aggregators[i]->EncodeToProtoValue(reg.values[i]));
+      values_size += CodedOutputStream::VarintSize64(encoded_values[i]);
+    }
+    size_t register_size = 0;
+    if (reg.index != 0) {
+      register_size += CodedOutputStream::VarintSize32(kIndexTag) +
+                       CodedOutputStream::VarintSize64(reg.index);
+    }
+    if (values_size > 0) {
+      register_size += CodedOutputStream::VarintSize32(kValuesTag) +
+                       CodedOutputStream::VarintSize64(values_size) +
+                       values_size;
+    }
+
+    stream.WriteTag(kRegistersTag);
+    stream.WriteVarint64(register_size);
+    if (reg.index != 0) {
+      stream.WriteTag(kIndexTag);
+      stream.WriteVarint64(reg.index);
+    }
+    if (values_size > 0) {
+      stream.WriteTag(kValuesTag);
+      stream.WriteVarint64(values_size);
+      for (uint64_t value : encoded_values) {
+        stream.WriteVarint64(value);
+      }
+    }
+  }
+  stream.Trim();
+  if (stream.HadError()) {
+    return absl::DataLossError("Failed to write the sketch to the output");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace wfa::any_sketch
@@ -0,0 +1,49 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SRC_MAIN_CC_ANY_SKETCH_SKETCH_PROTO_CONVERSION_H_
+#define SRC_MAIN_CC_ANY_SKETCH_SKETCH_PROTO_CONVERSION_H_
+
+#include "absl/status/status.h"
+#include "any_sketch/any_sketch.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+
+// Replaces the registers of `sketch_proto` with those of `sketch`, in the
+// iteration order of `sketch`. Values are stored as encoded by
+// Aggregator::EncodeToProtoValue. Other fields of `sketch_proto` are kept.
+//
+// The repeated fields are sized up front. If `sketch_proto` was allocated on
+// an Arena, the registers are allocated on the same Arena.
+void ToProto(const AnySketch& sketch, Sketch* sketch_proto);
+
+// Aggregates the registers of `sketch_proto` into `sketch`, decoding values
+// with Aggregator::DecodeFromProtoValue. The config of `sketch_proto` is not
+// checked against `sketch`.
+absl::Status FromProto(const Sketch& sketch_proto, AnySketch* sketch);
+
+// Serializes `sketch` to `output` in the wire format of a Sketch message
+// holding only its registers, without building the message in memory. The
+// bytes are the same as those of serializing the result of ToProto on an empty
+// Sketch. As fields of concatenated messages are merged, a config can be added
+// by writing a Sketch that holds only the config before or after.
+absl::Status WriteSketchProto(
+    const AnySketch& sketch,
+    google::protobuf::io::ZeroCopyOutputStream* output);
+
+}  // namespace wfa::any_sketch
+
+#endif  // SRC_MAIN_CC_ANY_SKETCH_SKETCH_PROTO_CONVERSION_H_
@@ -14,7 +14,9 @@
 
 #include "any_sketch/aggregators.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -53,5 +55,43 @@ TEST(AggregatorsTest, UniqueAggregator) {
   EXPECT_EQ(aggregator.DecodeFromProtoValue(-1), -2);
   EXPECT_EQ(aggregator.DecodeFromProtoValue(123), 122);
 }
+
+// Aggregates `src` into `dst` with the virtual Aggregators.
+std::vector<int64_t> AggregateWithAggregators(
+    const std::vector<AggregatorType>& types, std::vector<int64_t> dst,
+    const std::vector<int64_t>& src) {
+  for (size_t i = 0; i < dst.size(); ++i) {
+    dst[i] = GetAggregator(types[i % types.size()]).Aggregate(dst[i], src[i]);
+  }
+  return dst;
+}
+
+TEST(AggregatorsTest, AggregationKernelsMatchAggregators) {
+  const AggregatorType kS = AggregatorType::kSum;
+  const AggregatorType kU = AggregatorType::kUnique;
+  const std::vector<std::vector<AggregatorType>> configs = {
+      {kS},         {kU},         {kS, kU},     {kU, kS},
+      {kU, kU},     {kS, kS, kU}, {kU, kS, kU}, {kS, kS, kS, kS, kS, kS},
+  };
+  // Two registers of six values each, so every config sees whole registers.
+  const std::vector<int64_t> dst = {1, 2, 3, 4, -1, 6, 7, 8, 9, 10, 11, 12};
+  const std::vector<int64_t> src = {1, 5, 3, 0, -1, 6, 2, 8, 9, -3, 11, 0};
+
+  for (const std::vector<AggregatorType>& types : configs) {
+    AggregationKernel kernel = GetAggregationKernel(types);
+    ASSERT_NE(kernel, nullptr);
+    std::vector<int64_t> actual = dst;
+    kernel(actual.data(), src.data(), actual.size());
+    EXPECT_EQ(actual, AggregateWithAggregators(types, dst, src));
+  }
+}
+
+TEST(AggregatorsTest, NoAggregationKernelForUnspecializedTypes) {
+  const AggregatorType kS = AggregatorType::kSum;
+  const AggregatorType kU = AggregatorType::kUnique;
+
+  EXPECT_EQ(GetAggregationKernel({}), nullptr);
+  EXPECT_EQ(GetAggregationKernel({kS, kU, kS, kU}), nullptr);
+}
 }  // namespace
 }  // namespace wfa::any_sketch
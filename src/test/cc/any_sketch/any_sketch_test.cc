@@ -14,10 +14,12 @@
 
 #include "any_sketch/any_sketch.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/fixed_array.h"
 #include "absl/memory/memory.h"
@@ -25,18 +27,24 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_join.h"
 #include "absl/types/span.h"
+#include "any_sketch/derived_fingerprinter.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/testing/status_macros.h"
 #include "common_cpp/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace wfa::any_sketch {
 namespace {
+using ::testing::ElementsAre;
 using ::testing::ExplainMatchResult;
 using ::testing::IsEmpty;
 using ::testing::Matcher;
 using ::testing::MatcherInterface;
 using ::testing::MatchResultListener;
+using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
+using ::testing::UnorderedElementsAreArray;
 
 class RegisterIsMatcher : public MatcherInterface<const AnySketch::Register&> {
  public:
@@ -45,7 +53,9 @@ class RegisterIsMatcher : public MatcherInterface<const AnySketch::Register&> {
 
   bool MatchAndExplain(const wfa::any_sketch::AnySketch::Register& reg,
                        MatchResultListener* /* listener */) const override {
-    return reg.index == index_ && reg.values.size() == values_.size();
+    return reg.index == index_ &&
+           std::equal(reg.values.begin(), reg.values.end(), values_.begin(),
+                      values_.end());
   }
 
   void DescribeTo(std::ostream* os) const override {
@@ -193,5 +203,468 @@ TEST(AnySketchTest, Merge) {
               UnorderedElementsAre(RegisterIs(1, {12}), RegisterIs(2, {6}),
                                    RegisterIs(3, {8})));
 }
+
+TEST(AnySketchTest, InsertBatchMatchesInsert) {
+  auto make_sketch = []() {
+    std::vector<ValueFunction> value_functions;
+    value_functions.push_back(MakeOracleValueFunction("foo"));
+    value_functions.push_back(
+        MakeValueFunction(AggregatorType::kUnique, MakeFakeDistribution()));
+    return AnySketch(MakeFakeDistributionIndex(), std::move(value_functions));
+  };
+  std::vector<absl::string_view> items = {"a", "bb", "c", "dddd", "bb"};
+  std::vector<ItemMetadata> item_metadata = {
+      {{"foo", 5}}, {{"foo", 6}}, {{"foo", 7}}, {{"foo", 8}}, {{"foo", 9}}};
+
+  AnySketch expected = make_sketch();
+  for (size_t i = 0; i < items.size(); ++i) {
+    ASSERT_THAT(expected.Insert(items[i], item_metadata[i]), IsOk());
+  }
+  AnySketch sketch = make_sketch();
+  ASSERT_THAT(sketch.InsertBatch(items, item_metadata), IsOk());
+
+  auto expected_registers = UnorderedElementsAre(
+      RegisterIs(1, {12, 1}), RegisterIs(2, {15, 2}), RegisterIs(4, {8, 4}));
+  EXPECT_THAT(GetRegisters(expected), expected_registers);
+  EXPECT_THAT(GetRegisters(sketch), expected_registers);
+}
+
+TEST(AnySketchTest, InsertBatchWithoutMetadata) {
+  AnySketch sketch(MakeFakeDistributionIndex(),
+                   MakeSingleItemVector(MakeValueFunction(
+                       AggregatorType::kSum, MakeFakeDistribution())));
+
+  std::vector<absl::string_view> items = {"a", "b", "aa"};
+  ASSERT_THAT(sketch.InsertBatch(items), IsOk());
+
+  EXPECT_THAT(GetRegisters(sketch),
+              UnorderedElementsAre(RegisterIs(1, {2}), RegisterIs(2, {2})));
+}
+
+TEST(AnySketchTest, InsertBatchUint64MatchesInsert) {
+  AnySketch expected(MakeFakeDistributionIndex(), {});
+  AnySketch sketch(MakeFakeDistributionIndex(), {});
+  std::vector<uint64_t> items = {1, 2, 3};
+
+  for (uint64_t item : items) {
+    ASSERT_THAT(expected.Insert(item, {}), IsOk());
+  }
+  ASSERT_THAT(sketch.InsertBatch(items), IsOk());
+
+  // Every uint64 item is encoded as 8 bytes.
+  EXPECT_THAT(GetRegisters(sketch), UnorderedElementsAre(RegisterIs(8, {})));
+  EXPECT_THAT(GetRegisters(expected), UnorderedElementsAre(RegisterIs(8, {})));
+}
+
+TEST(AnySketchTest, InsertBatchErrorLeavesSketchUnchanged) {
+  AnySketch sketch(MakeFakeDistributionIndex(),
+                   MakeSingleItemVector(MakeOracleValueFunction("foo")));
+
+  std::vector<absl::string_view> items = {"a", "bb"};
+  std::vector<ItemMetadata> item_metadata = {{{"foo", 5}}, {{"wrong-key", 6}}};
+  EXPECT_THAT(sketch.InsertBatch(items, item_metadata), IsNotOk());
+  EXPECT_THAT(GetRegisters(sketch), IsEmpty());
+
+  std::vector<ItemMetadata> too_few_metadata = {{{"foo", 5}}};
+  EXPECT_THAT(sketch.InsertBatch(items, too_few_metadata), IsNotOk());
+  EXPECT_THAT(GetRegisters(sketch), IsEmpty());
+}
+
+TEST(AnySketchTest, FeatureNamesAreDeduplicated) {
+  std::vector<ValueFunction> value_functions;
+  value_functions.push_back(MakeOracleValueFunction("key2"));
+  value_functions.push_back(
+      MakeValueFunction(AggregatorType::kSum, MakeFakeDistribution()));
+  value_functions.push_back(MakeOracleValueFunction("key1"));
+  value_functions.push_back(MakeOracleValueFunction("key2"));
+  AnySketch sketch(MakeFakeDistributionIndex(), std::move(value_functions));
+
+  EXPECT_THAT(sketch.feature_names(), ElementsAre("key2", "key1"));
+}
+
+TEST(AnySketchTest, InsertWithFeaturesMatchesInsert) {
+  auto make_sketch = []() {
+    std::vector<ValueFunction> value_functions;
+    value_functions.push_back(MakeOracleValueFunction("key1"));
+    value_functions.push_back(MakeOracleValueFunction("key2"));
+    value_functions.push_back(MakeOracleValueFunction("key1"));
+    return AnySketch(MakeFakeDistributionIndex(), std::move(value_functions));
+  };
+  AnySketch expected = make_sketch();
+  ASSERT_THAT(expected.Insert("ABCD", {{"key1", 10}, {"key2", 11}}), IsOk());
+  ASSERT_THAT(expected.Insert("ABCD", {{"key1", 5}, {"key2", 6}}), IsOk());
+  ASSERT_THAT(expected.Insert(uint64_t{7}, {{"key1", 8}, {"key2", 9}}),
+              IsOk());
+
+  AnySketch sketch = make_sketch();
+  ASSERT_THAT(sketch.feature_names(), ElementsAre("key1", "key2"));
+  ASSERT_THAT(sketch.InsertWithFeatures("ABCD", std::vector<int64_t>{10, 11}),
+              IsOk());
+  ASSERT_THAT(sketch.InsertWithFeatures("ABCD", std::vector<int64_t>{5, 6}),
+              IsOk());
+  ASSERT_THAT(
+      sketch.InsertWithFeatures(uint64_t{7}, std::vector<int64_t>{8, 9}),
+      IsOk());
+
+  auto expected_registers = UnorderedElementsAre(RegisterIs(4, {15, 17, 15}),
+                                                 RegisterIs(8, {8, 9, 8}));
+  EXPECT_THAT(GetRegisters(expected), expected_registers);
+  EXPECT_THAT(GetRegisters(sketch), expected_registers);
+}
+
+TEST(AnySketchTest, InsertBatchWithFeaturesMatchesInsertBatch) {
+  auto make_sketch = []() {
+    std::vector<ValueFunction> value_functions;
+    value_functions.push_back(MakeOracleValueFunction("foo"));
+    value_functions.push_back(
+        MakeValueFunction(AggregatorType::kUnique, MakeFakeDistribution()));
+    value_functions.push_back(MakeOracleValueFunction("bar"));
+    return AnySketch(MakeFakeDistributionIndex(), std::move(value_functions));
+  };
+  std::vector<absl::string_view> items = {"a", "bb", "c", "dddd", "bb"};
+  std::vector<ItemMetadata> item_metadata = {
+      {{"foo", 5}, {"bar", 10}}, {{"foo", 6}, {"bar", 11}},
+      {{"foo", 7}, {"bar", 12}}, {{"foo", 8}, {"bar", 13}},
+      {{"foo", 9}, {"bar", 14}}};
+  // Column by column: all values of "foo", then all values of "bar".
+  std::vector<int64_t> feature_columns = {5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+
+  AnySketch expected = make_sketch();
+  ASSERT_THAT(expected.InsertBatch(items, item_metadata), IsOk());
+  AnySketch sketch = make_sketch();
+  ASSERT_THAT(sketch.InsertBatchWithFeatures(items, feature_columns), IsOk());
+
+  auto expected_registers = UnorderedElementsAre(RegisterIs(1, {12, 1, 22}),
+                                                 RegisterIs(2, {15, 2, 25}),
+                                                 RegisterIs(4, {8, 4, 13}));
+  EXPECT_THAT(GetRegisters(expected), expected_registers);
+  EXPECT_THAT(GetRegisters(sketch), expected_registers);
+}
+
+TEST(AnySketchTest, InsertBatchWithFeaturesErrorLeavesSketchUnchanged) {
+  AnySketch sketch(MakeFakeDistributionIndex(),
+                   MakeSingleItemVector(MakeOracleValueFunction("foo")));
+  std::vector<absl::string_view> items = {"a", "bb"};
+
+  EXPECT_THAT(sketch.InsertBatchWithFeatures(items, std::vector<int64_t>{5}),
+              IsNotOk());
+  // The oracle distribution only accepts values in [5, 15].
+  EXPECT_THAT(
+      sketch.InsertBatchWithFeatures(items, std::vector<int64_t>{5, 16}),
+      IsNotOk());
+  EXPECT_THAT(GetRegisters(sketch), IsEmpty());
+}
+
+std::vector<std::unique_ptr<BaseDistribution>> MakeSumSketchIndexes() {
+  std::vector<std::unique_ptr<BaseDistribution>> indexes;
+  indexes.push_back(MakeFakeDistribution());
+  indexes.push_back(MakeFakeDistribution());
+  return indexes;
+}
+
+std::vector<ValueFunction> MakeSumSketchValueFunctions() {
+  std::vector<ValueFunction> value_functions;
+  value_functions.push_back(MakeOracleValueFunction("foo"));
+  value_functions.push_back(
+      MakeValueFunction(AggregatorType::kUnique, MakeFakeDistribution()));
+  return value_functions;
+}
+
+AnySketch MakeSumSketch(const AnySketchOptions& options) {
+  return AnySketch(MakeSumSketchIndexes(), MakeSumSketchValueFunctions(),
+                   options);
+}
+
+std::unique_ptr<AnySketch> MakeUniqueSumSketch(
+    const AnySketchOptions& options) {
+  return absl::make_unique<AnySketch>(
+      MakeSumSketchIndexes(), MakeSumSketchValueFunctions(), options);
+}
+
+std::vector<std::pair<uint64_t, std::vector<int64_t>>> GetRegisterContents(
+    const AnySketch& sketch) {
+  std::vector<std::pair<uint64_t, std::vector<int64_t>>> contents;
+  for (const AnySketch::Register& reg : sketch) {
+    contents.emplace_back(
+        reg.index, std::vector<int64_t>(reg.values.begin(), reg.values.end()));
+  }
+  return contents;
+}
+
+TEST(AnySketchTest, StorageIsChosenByIndexSpaceSize) {
+  EXPECT_TRUE(MakeSumSketch({}).is_dense());
+  EXPECT_FALSE(MakeSumSketch({.max_dense_index_space = 0}).is_dense());
+  // Two index distributions of size 11 linearize to at most 11 * 10 + 10.
+  EXPECT_TRUE(MakeSumSketch({.max_dense_index_space = 121}).is_dense());
+  EXPECT_FALSE(MakeSumSketch({.max_dense_index_space = 120}).is_dense());
+}
+
+TEST(AnySketchTest, DenseAndSparseSketchesHoldSameRegisters) {
+  AnySketch dense = MakeSumSketch({});
+  AnySketch sparse = MakeSumSketch({.max_dense_index_space = 0});
+  ASSERT_TRUE(dense.is_dense());
+  ASSERT_FALSE(sparse.is_dense());
+
+  for (AnySketch* sketch : {&dense, &sparse}) {
+    ASSERT_THAT(sketch->Insert("a", {{"foo", 5}}), IsOk());
+    ASSERT_THAT(sketch->Insert("bb", {{"foo", 6}}), IsOk());
+    ASSERT_THAT(sketch->Insert("c", {{"foo", 7}}), IsOk());
+    ASSERT_THAT(sketch->Insert("dddddddddd", {{"foo", 8}}), IsOk());
+  }
+
+  auto expected_registers =
+      UnorderedElementsAre(RegisterIs(12, {12, 1}), RegisterIs(24, {6, 2}),
+                           RegisterIs(120, {8, 10}));
+  EXPECT_THAT(GetRegisters(dense), expected_registers);
+  EXPECT_THAT(GetRegisters(sparse), expected_registers);
+}
+
+TEST(AnySketchTest, DenseAggregateIntoRegisterOutsideIndexSpaceFails) {
+  AnySketch sketch = MakeSumSketch({});
+  ASSERT_TRUE(sketch.is_dense());
+
+  EXPECT_THAT(sketch.AggregateIntoRegister(120, {1, 2}), IsOk());
+  EXPECT_THAT(sketch.AggregateIntoRegister(121, {1, 2}), IsNotOk());
+  EXPECT_THAT(sketch.AggregateIntoRegister(-1, {1, 2}), IsNotOk());
+  EXPECT_THAT(GetRegisters(sketch),
+              UnorderedElementsAre(RegisterIs(120, {1, 2})));
+}
+
+TEST(AnySketchTest, OnlySparseAggregateIntoRegisterAcceptsAnyIndex) {
+  AnySketch dense = MakeSumSketch({});
+  AnySketch sparse = MakeSumSketch({.max_dense_index_space = 0});
+
+  EXPECT_THAT(dense.AggregateIntoRegister(1000, {1, 2}),
+              StatusIs(absl::StatusCode::kInvalidArgument, "outside"));
+  EXPECT_THAT(sparse.AggregateIntoRegister(1000, {1, 2}), IsOk());
+  EXPECT_THAT(GetRegisters(sparse),
+              UnorderedElementsAre(RegisterIs(1000, {1, 2})));
+}
+
+TEST(AnySketchTest, MergeOutsideIndexSpaceFailsOnlyIntoDense) {
+  AnySketch other = MakeSumSketch({.max_dense_index_space = 0});
+  ASSERT_THAT(other.AggregateIntoRegister(1000, {1, 2}), IsOk());
+
+  AnySketch dense = MakeSumSketch({});
+  EXPECT_THAT(dense.Merge(other),
+              StatusIs(absl::StatusCode::kInvalidArgument, "outside"));
+  EXPECT_EQ(dense.num_registers(), 0);
+
+  AnySketch sparse = MakeSumSketch({.max_dense_index_space = 0});
+  EXPECT_THAT(sparse.Merge(other), IsOk());
+  EXPECT_THAT(GetRegisters(sparse),
+              UnorderedElementsAre(RegisterIs(1000, {1, 2})));
+}
+
+TEST(AnySketchTest, MergeAcrossStorageModes) {
+  for (uint64_t max_dense_index_space : {0, 1000}) {
+    AnySketch sketch1 = MakeSumSketch({});
+    AnySketch sketch2 =
+        MakeSumSketch({.max_dense_index_space = max_dense_index_space});
+
+    ASSERT_THAT(sketch1.AggregateIntoRegister(0, {1, 3}), IsOk());
+    ASSERT_THAT(sketch1.AggregateIntoRegister(64, {2, 3}), IsOk());
+    ASSERT_THAT(sketch2.AggregateIntoRegister(64, {5, 4}), IsOk());
+    ASSERT_THAT(sketch2.AggregateIntoRegister(100, {6, 3}), IsOk());
+
+    ASSERT_THAT(sketch1.Merge(sketch2), IsOk());
+    EXPECT_THAT(GetRegisters(sketch1),
+                UnorderedElementsAre(RegisterIs(0, {1, 3}),
+                                     RegisterIs(64, {7, -1}),
+                                     RegisterIs(100, {6, 3})));
+  }
+}
+
+TEST(AnySketchTest, SparseRegistersIterateInInsertionOrder) {
+  AnySketch sketch = MakeSumSketch({.max_dense_index_space = 0});
+
+  ASSERT_THAT(sketch.AggregateIntoRegister(100, {1, 3}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(5, {2, 3}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(100, {4, 3}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(1ULL << 40, {8, 2}), IsOk());
+
+  EXPECT_EQ(sketch.num_registers(), 3);
+  EXPECT_THAT(GetRegisters(sketch),
+              ElementsAre(RegisterIs(100, {5, 3}), RegisterIs(5, {2, 3}),
+                          RegisterIs(1ULL << 40, {8, 2})));
+}
+
+TEST(AnySketchTest, DenseRegistersIterateInIndexOrder) {
+  AnySketch sketch = MakeSumSketch({});
+
+  ASSERT_THAT(sketch.AggregateIntoRegister(100, {1, 3}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(5, {2, 3}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(63, {8, 2}), IsOk());
+  ASSERT_THAT(sketch.AggregateIntoRegister(64, {8, 2}), IsOk());
+
+  EXPECT_EQ(sketch.num_registers(), 4);
+  EXPECT_THAT(GetRegisters(sketch),
+              ElementsAre(RegisterIs(5, {2, 3}), RegisterIs(63, {8, 2}),
+                          RegisterIs(64, {8, 2}), RegisterIs(100, {1, 3})));
+}
+
+TEST(AnySketchTest, DenseMergeWithUnspecializedAggregators) {
+  auto make_sketch = [](const AnySketchOptions& options) {
+    std::vector<ValueFunction> value_functions;
+    for (AggregatorType type :
+         {AggregatorType::kSum, AggregatorType::kUnique, AggregatorType::kSum,
+          AggregatorType::kUnique}) {
+      value_functions.push_back(
+          MakeValueFunction(type, MakeFakeDistribution()));
+    }
+    return absl::make_unique<AnySketch>(MakeSumSketchIndexes(),
+                                        std::move(value_functions), options);
+  };
+  std::unique_ptr<AnySketch> dense = make_sketch({});
+  std::unique_ptr<AnySketch> sparse = make_sketch({.max_dense_index_space = 0});
+  std::unique_ptr<AnySketch> other = make_sketch({});
+  ASSERT_TRUE(dense->is_dense());
+  ASSERT_FALSE(sparse->is_dense());
+
+  for (int64_t index = 0; index < 121; ++index) {
+    ASSERT_THAT(other->AggregateIntoRegister(index, {1, 2, 3, index % 2}),
+                IsOk());
+    if (index % 5 != 0) {
+      for (AnySketch* sketch : {dense.get(), sparse.get()}) {
+        ASSERT_THAT(sketch->AggregateIntoRegister(index, {1, 2, 3, 0}),
+                    IsOk());
+      }
+    }
+  }
+
+  ASSERT_THAT(dense->Merge(*other), IsOk());
+  ASSERT_THAT(sparse->Merge(*other), IsOk());
+  EXPECT_EQ(dense->num_registers(), 121);
+  EXPECT_THAT(GetRegisterContents(*dense),
+              UnorderedElementsAreArray(GetRegisterContents(*sparse)));
+  EXPECT_THAT(GetRegisterContents(*dense)[1],
+              Pair(1, ElementsAre(2, 2, 6, kUniqueAggregatorDestroyedValue)));
+}
+
+TEST(AnySketchTest, ParallelMergeAllMatchesSerialMergeAll) {
+  // Half of the sketches are dense and half are sparse. Registers overlap
+  // across sketches, and the kUnique values only sometimes agree.
+  std::vector<std::unique_ptr<AnySketch>> others;
+  for (int i = 0; i < 8; ++i) {
+    others.push_back(MakeUniqueSumSketch(
+        {.max_dense_index_space = (i % 2 == 0) ? 1000u : 0u}));
+    for (int j = 0; j < 40; ++j) {
+      const int64_t index = (i * 37 + j * 13) % 121;
+      ASSERT_THAT(others.back()->AggregateIntoRegister(index, {i + j, j % 3}),
+                  IsOk());
+    }
+  }
+
+  for (uint64_t max_dense_index_space : {0, 1000}) {
+    for (int num_threads : {2, 3, 64}) {
+      std::unique_ptr<AnySketch> expected =
+          MakeUniqueSumSketch({.max_dense_index_space = max_dense_index_space});
+      std::unique_ptr<AnySketch> sketch =
+          MakeUniqueSumSketch({.max_dense_index_space = max_dense_index_space});
+      for (AnySketch* target : {expected.get(), sketch.get()}) {
+        ASSERT_THAT(target->AggregateIntoRegister(50, {1, 1}), IsOk());
+        ASSERT_THAT(target->AggregateIntoRegister(3, {1, 2}), IsOk());
+      }
+
+      ASSERT_THAT(expected->MergeAll(others), IsOk());
+      ASSERT_THAT(sketch->MergeAll(others, num_threads), IsOk());
+      EXPECT_EQ(GetRegisterContents(*sketch), GetRegisterContents(*expected));
+    }
+  }
+}
+
+TEST(AnySketchTest, ParallelMergeAllIntoDenseOutsideIndexSpaceFails) {
+  std::vector<std::unique_ptr<AnySketch>> others;
+  others.push_back(MakeUniqueSumSketch({.max_dense_index_space = 0}));
+  ASSERT_THAT(others.back()->AggregateIntoRegister(1000, {1, 1}), IsOk());
+
+  others.push_back(MakeUniqueSumSketch({}));
+  ASSERT_THAT(others.back()->AggregateIntoRegister(7, {1, 1}), IsOk());
+
+  std::unique_ptr<AnySketch> sketch = MakeUniqueSumSketch({});
+  ASSERT_TRUE(sketch->is_dense());
+  EXPECT_THAT(sketch->MergeAll(others, 4), IsNotOk());
+  EXPECT_EQ(sketch->num_registers(), 0);
+}
+
+TEST(AnySketchTest, ParallelMergeAllWithWrongRegisterSizeFails) {
+  std::vector<ValueFunction> value_functions;
+  value_functions.push_back(
+      MakeValueFunction(AggregatorType::kSum, MakeFakeDistribution()));
+  std::vector<std::unique_ptr<AnySketch>> others;
+  others.push_back(MakeUniqueSumSketch({}));
+  ASSERT_THAT(others.back()->AggregateIntoRegister(7, {1, 1}), IsOk());
+  others.push_back(absl::make_unique<AnySketch>(MakeSumSketchIndexes(),
+                                                std::move(value_functions)));
+  ASSERT_THAT(others.back()->AggregateIntoRegister(8, {1}), IsOk());
+
+  for (uint64_t max_dense_index_space : {0, 1000}) {
+    std::unique_ptr<AnySketch> sketch =
+        MakeUniqueSumSketch({.max_dense_index_space = max_dense_index_space});
+    ASSERT_THAT(sketch->AggregateIntoRegister(7, {1, 2}), IsOk());
+
+    EXPECT_THAT(sketch->MergeAll(others, 4),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         "wrong dimension"));
+    EXPECT_THAT(GetRegisterContents(*sketch),
+                ElementsAre(Pair(7, ElementsAre(1, 2))));
+  }
+}
+
+class CountingFingerprinter : public Fingerprinter {
+ public:
+  using Fingerprinter::Fingerprint;
+  uint64_t Fingerprint(absl::Span<const unsigned char> item) const override {
+    ++num_calls_;
+    return GetFarmFingerprinter().Fingerprint(item);
+  }
+
+  int num_calls() const { return num_calls_; }
+
+ private:
+  mutable int num_calls_ = 0;
+};
+
+TEST(AnySketchTest, FingerprintsEachItemOncePerBaseFingerprinter) {
+  CountingFingerprinter fingerprinter;
+  DerivedFingerprinter salted_a(&fingerprinter, "a");
+  DerivedFingerprinter salted_b(&fingerprinter, "b");
+  auto make_exponential = [&]() {
+    return GetExponentialDistribution(&fingerprinter, 10, 100);
+  };
+  auto make_geometric = [&]() {
+    return GetGeometricDistribution(&salted_a, 0, 7);
+  };
+  auto make_uniform = [&]() {
+    return GetUniformDistribution(&salted_b, 0, 1000);
+  };
+  std::vector<std::unique_ptr<BaseDistribution>> indexes;
+  indexes.push_back(make_exponential());
+  indexes.push_back(make_geometric());
+  AnySketch sketch(std::move(indexes),
+                   MakeSingleItemVector(MakeValueFunction(
+                       AggregatorType::kUnique, make_uniform())));
+
+  const int initial_calls = fingerprinter.num_calls();
+  ASSERT_THAT(sketch.Insert("item", {}), IsOk());
+  EXPECT_EQ(fingerprinter.num_calls() - initial_calls, 1);
+  std::vector<absl::string_view> items = {"a", "b", "c"};
+  ASSERT_THAT(sketch.InsertBatch(items), IsOk());
+  EXPECT_EQ(fingerprinter.num_calls() - initial_calls, 4);
+
+  // The registers are the same as with each distribution fingerprinting the
+  // items itself.
+  std::vector<Matcher<AnySketch::Register>> expected_registers;
+  for (absl::string_view item : {"item", "a", "b", "c"}) {
+    ASSERT_OK_AND_ASSIGN(int64_t exponential,
+                         make_exponential()->Apply(item, {}));
+    ASSERT_OK_AND_ASSIGN(int64_t geometric, make_geometric()->Apply(item, {}));
+    ASSERT_OK_AND_ASSIGN(int64_t uniform, make_uniform()->Apply(item, {}));
+    expected_registers.push_back(
+        RegisterIs(100 * exponential + geometric, {uniform}));
+  }
+  EXPECT_THAT(GetRegisters(sketch),
+              UnorderedElementsAreArray(expected_registers));
+}
 }  // namespace
 }  // namespace wfa::any_sketch
@@ -0,0 +1,255 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/encrypted_sketch_container.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "any_sketch/crypto/sketch_encrypter.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "gtest/gtest.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/commutative_elgamal.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+
+using ::google::protobuf::io::StringOutputStream;
+using ::private_join_and_compute::CommutativeElGamal;
+
+constexpr int kTestCurveId = NID_X9_62_prime256v1;
+constexpr int kMaxCounterValue = 10;
+
+// A header of 5 sketch registers and 2 noise registers of 8 bytes each, in
+// chunks of 3 registers.
+constexpr EncryptedSketchHeader kTestHeader = {.curve_id = kTestCurveId,
+                                               .ciphertext_size = 4,
+                                               .value_count = 1,
+                                               .registers_per_chunk = 3,
+                                               .register_count = 5,
+                                               .noise_register_count = 2};
+constexpr int kBytesPerRegister = 8;
+
+// Returns the ciphertexts of the test header, where register i is made of the
+// character 'a' + i.
+std::string CreateTestCiphertexts() {
+  std::string ciphertexts;
+  for (int i = 0; i < 7; ++i) {
+    ciphertexts.append(kBytesPerRegister, 'a' + i);
+  }
+  return ciphertexts;
+}
+
+std::string WriteTestContainer() {
+  std::string container;
+  StringOutputStream output(&container);
+  EXPECT_THAT(WriteEncryptedSketchContainer(kTestHeader,
+                                            CreateTestCiphertexts(), &output),
+              IsOk());
+  return container;
+}
+
+TEST(EncryptedSketchContainerTest, RegistersShouldBeAtFixedOffsets) {
+  std::string container = WriteTestContainer();
+
+  ASSERT_OK_AND_ASSIGN(EncryptedSketchView view,
+                       EncryptedSketchView::Create(container));
+
+  EXPECT_EQ(container.size(), kEncryptedSketchHeaderSize +
+                                  7 * kBytesPerRegister + 3 * sizeof(uint64_t));
+  EXPECT_EQ(view.header().register_count, 5);
+  EXPECT_EQ(view.header().noise_register_count, 2);
+  EXPECT_EQ(view.num_registers(), 7);
+  EXPECT_EQ(view.num_chunks(), 3);
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(view.GetRegister(i), std::string(kBytesPerRegister, 'a' + i));
+  }
+  EXPECT_EQ(view.GetChunk(2).size(), kBytesPerRegister + sizeof(uint64_t));
+  EXPECT_THAT(view.Verify(), IsOk());
+}
+
+TEST(EncryptedSketchContainerTest, ChunksShouldBeVerifiableOnTheirOwn) {
+  std::string container = WriteTestContainer();
+  absl::string_view data = container;
+
+  ASSERT_OK_AND_ASSIGN(EncryptedSketchHeader header,
+                       ParseEncryptedSketchHeader(
+                           data.substr(0, kEncryptedSketchHeaderSize)));
+  data.remove_prefix(kEncryptedSketchHeaderSize);
+
+  EXPECT_EQ(header.ciphertext_size, kTestHeader.ciphertext_size);
+  EXPECT_EQ(header.value_count, kTestHeader.value_count);
+  for (int i = 0; i < 3; ++i) {
+    const size_t chunk_size =
+        (i < 2 ? 3 : 1) * kBytesPerRegister + sizeof(uint64_t);
+    EXPECT_THAT(
+        VerifyEncryptedSketchChunk(header, i, data.substr(0, chunk_size)),
+        IsOk());
+    data.remove_prefix(chunk_size);
+  }
+  EXPECT_TRUE(data.empty());
+}
+
+TEST(EncryptedSketchContainerTest, CorruptedChunkShouldFailVerification) {
+  std::string container = WriteTestContainer();
+  ASSERT_OK_AND_ASSIGN(EncryptedSketchView view,
+                       EncryptedSketchView::Create(container));
+  // Corrupts register 4, in chunk 1.
+  container[view.GetRegister(4).data() - container.data()] ^= 1;
+
+  EXPECT_THAT(view.VerifyChunk(0), IsOk());
+  EXPECT_THAT(view.VerifyChunk(1), StatusIs(absl::StatusCode::kDataLoss,
+                                            "checksum of chunk 1"));
+  EXPECT_THAT(view.Verify(), IsNotOk());
+}
+
+TEST(EncryptedSketchContainerTest, CorruptedHeaderShouldThrow) {
+  std::string container = WriteTestContainer();
+  container[sizeof(uint32_t) * 6] ^= 1;
+
+  EXPECT_THAT(EncryptedSketchView::Create(container),
+              StatusIs(absl::StatusCode::kDataLoss, "checksum"));
+}
+
+TEST(EncryptedSketchContainerTest, TruncatedContainerShouldThrow) {
+  std::string container = WriteTestContainer();
+  container.pop_back();
+
+  EXPECT_THAT(EncryptedSketchView::Create(container),
+              StatusIs(absl::StatusCode::kInvalidArgument, "size"));
+  EXPECT_THAT(EncryptedSketchView::Create("WESK"), IsNotOk());
+}
+
+TEST(EncryptedSketchContainerTest, MismatchedCiphertextsShouldThrow) {
+  std::string container;
+  StringOutputStream output(&container);
+
+  EXPECT_THAT(WriteEncryptedSketchContainer(
+                  kTestHeader, CreateTestCiphertexts().substr(1), &output),
+              StatusIs(absl::StatusCode::kInvalidArgument, "size"));
+}
+
+TEST(EncryptedSketchContainerTest, EncryptToContainerShouldCountNoise) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CommutativeElGamal> cipher,
+                       CommutativeElGamal::CreateWithNewKeyPair(kTestCurveId));
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair, cipher->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> sketch_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second}));
+  Sketch sketch;
+  sketch.mutable_config()->add_values()->set_aggregator(
+      SketchConfig::ValueSpec::UNIQUE);
+  for (int i = 0; i < 10; ++i) {
+    Sketch::Register* sketch_register = sketch.add_registers();
+    sketch_register->set_index(i);
+    sketch_register->add_values(i);
+  }
+  EncryptSketchRequest::PublisherNoiseParameter noise_parameter;
+  noise_parameter.set_epsilon(1);
+  noise_parameter.set_delta(0.1);
+  noise_parameter.set_publisher_count(3);
+
+  std::string container;
+  StringOutputStream output(&container);
+  ASSERT_THAT(
+      EncryptToContainer(*sketch_encrypter, sketch,
+                         EncryptSketchRequest::FLAGGED_KEY, &noise_parameter,
+                         /*registers_per_chunk=*/4, &output),
+      IsOk());
+  ASSERT_OK_AND_ASSIGN(EncryptedSketchView view,
+                       EncryptedSketchView::Create(container));
+
+  EXPECT_EQ(view.header().curve_id, kTestCurveId);
+  EXPECT_EQ(view.header().ciphertext_size, 66);
+  EXPECT_EQ(view.header().value_count, 1);
+  EXPECT_EQ(view.header().register_count, 10);
+  EXPECT_GT(view.header().noise_register_count, 0);
+  EXPECT_THAT(view.Verify(), IsOk());
+}
+
+TEST(EncryptedSketchContainerTest, EncryptToContainerShouldDecryptByRegister) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CommutativeElGamal> cipher,
+                       CommutativeElGamal::CreateWithNewKeyPair(kTestCurveId));
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair, cipher->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> sketch_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second}));
+  Sketch sketch;
+  sketch.mutable_config()->add_values()->set_aggregator(
+      SketchConfig::ValueSpec::UNIQUE);
+  for (int i = 0; i < 10; ++i) {
+    Sketch::Register* sketch_register = sketch.add_registers();
+    sketch_register->set_index(i);
+    sketch_register->add_values(i);
+  }
+  ASSERT_OK_AND_ASSIGN(std::string expected_sketch,
+                       sketch_encrypter->Encrypt(
+                           sketch, EncryptSketchRequest::FLAGGED_KEY));
+
+  // Chunks that divide the registers evenly, that do not, and a single one.
+  for (uint32_t registers_per_chunk : {5u, 3u, kDefaultRegistersPerChunk}) {
+    SCOPED_TRACE(registers_per_chunk);
+    std::string container;
+    StringOutputStream output(&container);
+    ASSERT_THAT(EncryptToContainer(*sketch_encrypter, sketch,
+                                   EncryptSketchRequest::FLAGGED_KEY,
+                                   /*publisher_noise_parameter=*/nullptr,
+                                   registers_per_chunk, &output),
+                IsOk());
+    ASSERT_OK_AND_ASSIGN(EncryptedSketchView view,
+                         EncryptedSketchView::Create(container));
+    EXPECT_THAT(view.Verify(), IsOk());
+    ASSERT_EQ(view.num_registers(), 10);
+    EXPECT_EQ(view.header().noise_register_count, 0);
+    EXPECT_EQ(view.num_chunks(), (10 + registers_per_chunk - 1) /
+                                     registers_per_chunk);
+
+    // Every ciphertext decrypts to the same point as the one Encrypt returns.
+    const size_t ciphertext_size = view.header().ciphertext_size;
+    const size_t point_size = ciphertext_size / 2;
+    for (uint64_t i = 0; i < view.num_registers(); ++i) {
+      const absl::string_view reg = view.GetRegister(i);
+      for (size_t offset = 0; offset < reg.size(); offset += ciphertext_size) {
+        const size_t expected_offset = i * reg.size() + offset;
+        ASSERT_OK_AND_ASSIGN(
+            std::string expected,
+            cipher->Decrypt(std::make_pair(
+                expected_sketch.substr(expected_offset, point_size),
+                expected_sketch.substr(expected_offset + point_size,
+                                       point_size))));
+        EXPECT_THAT(cipher->Decrypt(std::make_pair(
+                        std::string(reg.substr(offset, point_size)),
+                        std::string(
+                            reg.substr(offset + point_size, point_size)))),
+                    IsOkAndHolds(expected));
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch::crypto
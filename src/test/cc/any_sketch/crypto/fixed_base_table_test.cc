@@ -0,0 +1,125 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/fixed_base_table.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/big_num.h"
+#include "private_join_and_compute/crypto/context.h"
+#include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+
+using ::private_join_and_compute::BigNum;
+using ::private_join_and_compute::Context;
+using ::private_join_and_compute::ECGroup;
+using ::private_join_and_compute::ECPoint;
+
+constexpr int kTestCurveId = NID_X9_62_prime256v1;
+
+class FixedBaseTableTest : public ::testing::Test {
+ protected:
+  FixedBaseTableTest()
+      : ec_group_(ECGroup::Create(kTestCurveId, &ctx_).value()),
+        base_(ec_group_.GetRandomGenerator().value()) {}
+
+  // Returns 2^bits - 1.
+  BigNum AllOnes(int bits) { return ctx_.One().Lshift(bits) - ctx_.One(); }
+
+  Context ctx_;
+  ECGroup ec_group_;
+  ECPoint base_;
+};
+
+TEST_F(FixedBaseTableTest, MulShouldMatchECPointMul) {
+  const BigNum& order = ec_group_.GetOrder();
+  const int scalar_bits = order.BitLength();
+  ASSERT_OK_AND_ASSIGN(FixedBaseTable table,
+                       FixedBaseTable::Create(base_, scalar_bits));
+  // Each row of the table covers kWindowBits bits, so the last row may cover
+  // a few bits more than scalar_bits.
+  const int num_rows = (scalar_bits + FixedBaseTable::kWindowBits - 1) /
+                       FixedBaseTable::kWindowBits;
+
+  std::vector<BigNum> scalars = {
+      ctx_.Zero(),
+      ctx_.One(),
+      ctx_.CreateBigNum(2),
+      order - ctx_.One(),
+      order,
+      AllOnes(FixedBaseTable::kWindowBits),
+      AllOnes(2 * FixedBaseTable::kWindowBits),
+      AllOnes(scalar_bits),
+      AllOnes(num_rows * FixedBaseTable::kWindowBits),
+      ctx_.One().Lshift(FixedBaseTable::kWindowBits),
+  };
+  for (int i = 0; i < 10; ++i) {
+    scalars.push_back(ec_group_.GeneratePrivateKey());
+  }
+
+  for (const BigNum& scalar : scalars) {
+    SCOPED_TRACE(scalar.ToDecimalString());
+    ASSERT_OK_AND_ASSIGN(ECPoint expected, base_.Mul(scalar));
+    ASSERT_OK_AND_ASSIGN(ECPoint actual, table.Mul(ec_group_, scalar));
+    EXPECT_EQ(actual.IsPointAtInfinity(), expected.IsPointAtInfinity());
+    EXPECT_TRUE(actual.CompareTo(expected));
+  }
+}
+
+TEST_F(FixedBaseTableTest, MulOfZeroShouldBePointAtInfinity) {
+  ASSERT_OK_AND_ASSIGN(FixedBaseTable table, FixedBaseTable::Create(base_, 8));
+
+  ASSERT_OK_AND_ASSIGN(ECPoint result, table.Mul(ec_group_, ctx_.Zero()));
+  EXPECT_TRUE(result.IsPointAtInfinity());
+}
+
+TEST_F(FixedBaseTableTest, MulInAnotherGroupShouldMatchECPointMul) {
+  ASSERT_OK_AND_ASSIGN(FixedBaseTable table,
+                       FixedBaseTable::Create(base_, 12));
+  Context other_ctx;
+  ASSERT_OK_AND_ASSIGN(ECGroup other_ec_group,
+                       ECGroup::Create(kTestCurveId, &other_ctx));
+
+  for (int n : {1, 63, 64, 4095}) {
+    SCOPED_TRACE(n);
+    ASSERT_OK_AND_ASSIGN(ECPoint expected, base_.Mul(ctx_.CreateBigNum(n)));
+    ASSERT_OK_AND_ASSIGN(ECPoint actual,
+                         table.Mul(other_ec_group, other_ctx.CreateBigNum(n)));
+    ASSERT_OK_AND_ASSIGN(std::string expected_bytes,
+                         expected.ToBytesCompressed());
+    ASSERT_OK_AND_ASSIGN(std::string actual_bytes, actual.ToBytesCompressed());
+    EXPECT_EQ(actual_bytes, expected_bytes);
+  }
+}
+
+TEST_F(FixedBaseTableTest, TooLargeScalarShouldThrow) {
+  ASSERT_OK_AND_ASSIGN(FixedBaseTable table,
+                       FixedBaseTable::Create(base_, 12));
+
+  EXPECT_THAT(table.Mul(ec_group_, ctx_.CreateBigNum(4096)),
+              StatusIs(absl::StatusCode::kInvalidArgument, "too large"));
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch::crypto
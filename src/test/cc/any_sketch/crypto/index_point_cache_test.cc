@@ -0,0 +1,192 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/index_point_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/context.h"
+#include "private_join_and_compute/crypto/ec_group.h"
+#include "private_join_and_compute/crypto/ec_point.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+
+using ::private_join_and_compute::Context;
+using ::private_join_and_compute::ECGroup;
+using ::private_join_and_compute::ECPoint;
+using ::testing::Optional;
+
+constexpr int kTestCurveId = NID_X9_62_prime256v1;
+constexpr int kOtherCurveId = NID_secp224r1;
+// Offset of the number of slots in the file header, after the magic, the
+// version, the curve id and the point size.
+constexpr long kNumSlotsOffset = 24;
+
+// Returns the compressed point that index hashes to on the test curve.
+std::string HashIndex(int64_t index) {
+  Context ctx;
+  ECGroup ec_group = ECGroup::Create(kTestCurveId, &ctx).value();
+  ECPoint point =
+      ec_group.GetPointByHashingToCurveSha256(std::to_string(index)).value();
+  return point.ToBytesCompressed().value();
+}
+
+class IndexPointCacheFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    file_path_ = absl::StrCat(
+        ::testing::TempDir(), "/",
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::remove(file_path_.c_str());
+  }
+
+  void TearDown() override { std::remove(file_path_.c_str()); }
+
+  std::string file_path_;
+};
+
+TEST(IndexPointCacheTest, LookupShouldReturnInsertedPoint) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create({}));
+
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 1), std::nullopt);
+  cache->Insert(kTestCurveId, 1, "point");
+  EXPECT_THAT(cache->Lookup(kTestCurveId, 1), Optional(std::string("point")));
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 2), std::nullopt);
+  EXPECT_EQ(cache->Lookup(kOtherCurveId, 1), std::nullopt);
+}
+
+TEST(IndexPointCacheTest, LeastRecentlyUsedPointShouldBeEvicted) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create({.capacity = 2}));
+
+  cache->Insert(kTestCurveId, 1, "1");
+  cache->Insert(kTestCurveId, 2, "2");
+  ASSERT_NE(cache->Lookup(kTestCurveId, 1), std::nullopt);
+  cache->Insert(kTestCurveId, 3, "3");
+
+  EXPECT_EQ(cache->size(), 2);
+  EXPECT_THAT(cache->Lookup(kTestCurveId, 1), Optional(std::string("1")));
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 2), std::nullopt);
+  EXPECT_THAT(cache->Lookup(kTestCurveId, 3), Optional(std::string("3")));
+}
+
+TEST(IndexPointCacheTest, ZeroCapacityShouldCacheNothing) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create({.capacity = 0}));
+
+  cache->Insert(kTestCurveId, 1, "1");
+
+  EXPECT_EQ(cache->size(), 0);
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 1), std::nullopt);
+}
+
+TEST_F(IndexPointCacheFileTest, PointsShouldOutliveTheCache) {
+  const IndexPointCacheOptions options = {.capacity = 0,
+                                          .file_path = file_path_,
+                                          .curve_id = kTestCurveId,
+                                          .file_capacity = 1000};
+  {
+    ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                         IndexPointCache::Create(options));
+    for (int64_t index = 0; index < 10; ++index) {
+      cache->Insert(kTestCurveId, index, HashIndex(index));
+    }
+  }
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create(options));
+  int num_hits = 0;
+  for (int64_t index = 0; index < 10; ++index) {
+    std::optional<std::string> point = cache->Lookup(kTestCurveId, index);
+    if (point.has_value()) {
+      EXPECT_EQ(*point, HashIndex(index));
+      ++num_hits;
+    }
+  }
+  // Some indexes may have been replaced by others sharing their slot.
+  EXPECT_GT(num_hits, 0);
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 10), std::nullopt);
+}
+
+TEST_F(IndexPointCacheFileTest, PointsOfOtherCurvesShouldNotBeStored) {
+  const IndexPointCacheOptions options = {.capacity = 0,
+                                          .file_path = file_path_,
+                                          .curve_id = kTestCurveId,
+                                          .file_capacity = 1};
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create(options));
+
+  cache->Insert(kOtherCurveId, 1, "1");
+
+  EXPECT_EQ(cache->Lookup(kOtherCurveId, 1), std::nullopt);
+  EXPECT_EQ(cache->Lookup(kTestCurveId, 1), std::nullopt);
+}
+
+TEST_F(IndexPointCacheFileTest, FileOfOtherCurveShouldThrow) {
+  ASSERT_THAT(IndexPointCache::Create({.file_path = file_path_,
+                                       .curve_id = kTestCurveId,
+                                       .file_capacity = 1}),
+              IsOk());
+
+  EXPECT_THAT(IndexPointCache::Create({.file_path = file_path_,
+                                       .curve_id = kOtherCurveId,
+                                       .file_capacity = 1}),
+              StatusIs(absl::StatusCode::kInvalidArgument, "curve"));
+}
+
+TEST_F(IndexPointCacheFileTest, MalformedFileShouldThrow) {
+  std::FILE* file = std::fopen(file_path_.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  std::fputs("not a cache", file);
+  std::fclose(file);
+
+  EXPECT_THAT(IndexPointCache::Create(
+                  {.file_path = file_path_, .curve_id = kTestCurveId}),
+              StatusIs(absl::StatusCode::kInvalidArgument, "not an index"));
+
+  // A valid header, except for its number of slots.
+  for (uint64_t num_slots : {uint64_t{0}, ~uint64_t{0}, uint64_t{1} << 60}) {
+    SCOPED_TRACE(num_slots);
+    std::remove(file_path_.c_str());
+    ASSERT_THAT(IndexPointCache::Create({.file_path = file_path_,
+                                         .curve_id = kTestCurveId,
+                                         .file_capacity = 1}),
+                IsOk());
+    file = std::fopen(file_path_.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(std::fseek(file, kNumSlotsOffset, SEEK_SET), 0);
+    ASSERT_EQ(std::fwrite(&num_slots, sizeof(num_slots), 1, file), 1);
+    std::fclose(file);
+
+    EXPECT_THAT(IndexPointCache::Create({.file_path = file_path_,
+                                         .curve_id = kTestCurveId,
+                                         .file_capacity = 1}),
+                StatusIs(absl::StatusCode::kInvalidArgument, "slots"));
+  }
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch::crypto
@@ -16,6 +16,7 @@
 
 #include "common_cpp/testing/random.h"
 #include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "openssl/obj_mac.h"
@@ -134,5 +135,24 @@ TEST(SketchEncrypterJavaAdapterTest, noiseShouldBeAddedIfNoiseParameterIsSet) {
             register_size * bytes_per_register);
 }
 
+TEST(SketchEncrypterJavaAdapterTest, emptySketchShouldHaveEmptyResponse) {
+  // Generate a key for testing.
+  ASSERT_OK_AND_ASSIGN(auto commutativeElGamal,
+                       CommutativeElGamal::CreateWithNewKeyPair(kTestCurveId));
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       commutativeElGamal->GetPublicKeyBytes());
+
+  // Build the request
+  wfa::any_sketch::crypto::EncryptSketchRequest request;
+  request.mutable_el_gamal_keys()->set_generator(public_key_pair.first);
+  request.mutable_el_gamal_keys()->set_element(public_key_pair.second);
+  request.set_curve_id(kTestCurveId);
+  request.set_maximum_value(kMaxCounterValue);
+  *request.mutable_sketch()->mutable_config() = CreateSketchConfig(1, 1, 1);
+
+  EXPECT_THAT(EncryptSketch(request.SerializeAsString()),
+              IsOkAndHolds(EncryptSketchResponse().SerializeAsString()));
+}
+
 }  // namespace
 }  // namespace wfa::any_sketch::crypto
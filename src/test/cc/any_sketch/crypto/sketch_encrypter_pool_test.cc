@@ -0,0 +1,136 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/crypto/sketch_encrypter_pool.h"
+
+#include <memory>
+#include <utility>
+
+#include "any_sketch/crypto/sketch_encrypter.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "openssl/obj_mac.h"
+#include "private_join_and_compute/crypto/commutative_elgamal.h"
+
+namespace wfa::any_sketch::crypto {
+namespace {
+
+using ::private_join_and_compute::CommutativeElGamal;
+
+constexpr int kTestCurveId = NID_X9_62_prime256v1;
+constexpr int kMaxCounterValue = 10;
+
+class SketchEncrypterPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<CommutativeElGamal> cipher,
+        CommutativeElGamal::CreateWithNewKeyPair(kTestCurveId));
+    ASSERT_OK_AND_ASSIGN(auto public_key_pair, cipher->GetPublicKeyBytes());
+    public_key_ = {.u = public_key_pair.first, .e = public_key_pair.second};
+  }
+
+  CiphertextString public_key_;
+};
+
+TEST_F(SketchEncrypterPoolTest, ReleasedEncrypterShouldBeReused) {
+  SketchEncrypterPool pool;
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+  const SketchEncrypter* sketch_encrypter = lease.get();
+  EXPECT_EQ(pool.size(), 0);
+
+  lease.reset();
+  EXPECT_EQ(pool.size(), 1);
+  ASSERT_OK_AND_ASSIGN(
+      lease, pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+
+  EXPECT_EQ(lease.get(), sketch_encrypter);
+  EXPECT_EQ(pool.size(), 0);
+}
+
+TEST_F(SketchEncrypterPoolTest, LeasedEncrypterShouldNotBeShared) {
+  SketchEncrypterPool pool;
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease other_lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+
+  EXPECT_NE(lease.get(), other_lease.get());
+
+  lease.reset();
+  other_lease.reset();
+  EXPECT_EQ(pool.size(), 2);
+}
+
+TEST_F(SketchEncrypterPoolTest, EncrypterOfOtherParametersShouldNotBeReused) {
+  SketchEncrypterPool pool;
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+  lease.reset();
+
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease other_lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue + 1, public_key_));
+
+  EXPECT_EQ(pool.size(), 1);
+}
+
+TEST_F(SketchEncrypterPoolTest, LeastRecentlyReleasedEncrypterShouldBeEvicted) {
+  SketchEncrypterPool pool({.capacity = 1});
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease other_lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue + 1, public_key_));
+  const SketchEncrypter* other_sketch_encrypter = other_lease.get();
+
+  lease.reset();
+  other_lease.reset();
+  EXPECT_EQ(pool.size(), 1);
+  ASSERT_OK_AND_ASSIGN(
+      other_lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue + 1, public_key_));
+
+  EXPECT_EQ(other_lease.get(), other_sketch_encrypter);
+  EXPECT_EQ(pool.size(), 0);
+}
+
+TEST_F(SketchEncrypterPoolTest, ZeroCapacityShouldKeepNothing) {
+  SketchEncrypterPool pool({.capacity = 0});
+  ASSERT_OK_AND_ASSIGN(
+      SketchEncrypterPool::Lease lease,
+      pool.Acquire(kTestCurveId, kMaxCounterValue, public_key_));
+
+  lease.reset();
+
+  EXPECT_EQ(pool.size(), 0);
+}
+
+TEST_F(SketchEncrypterPoolTest, InvalidCurveShouldThrow) {
+  SketchEncrypterPool pool;
+
+  EXPECT_THAT(pool.Acquire(/*curve_id=*/0, kMaxCounterValue, public_key_),
+              IsNotOk());
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch::crypto
@@ -14,13 +14,17 @@
 
 #include "any_sketch/crypto/sketch_encrypter.h"
 
+#include <algorithm>
+
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "common_cpp/testing/random.h"
 #include "common_cpp/testing/status_macros.h"
 #include "common_cpp/testing/status_matchers.h"
 #include "gmock/gmock.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/util/message_differencer.h"
 #include "gtest/gtest.h"
 #include "openssl/obj_mac.h"
@@ -305,6 +309,55 @@ TEST_F(SketchEncrypterTest, MaximumCountValueShouldWork) {
   EXPECT_THAT(count_a, HasSameDecryption(original_cipher_.get(), count_b));
 }
 
+TEST_F(SketchEncrypterTest, CounterValuesShouldDecryptToUnitMultiples) {
+  Context context;
+  ASSERT_OK_AND_ASSIGN(ECGroup ec_group,
+                       ECGroup::Create(kTestCurveId, &context));
+  ASSERT_OK_AND_ASSIGN(
+      ECPoint unit_ec,
+      ec_group.GetPointByHashingToCurveSha256("unit_ec_point"));
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+
+  // 4095 sets every bit of two whole table windows.
+  for (int max_counter_value : {kMaxCounterValue, 4094}) {
+    SCOPED_TRACE(max_counter_value);
+    ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<SketchEncrypter> encrypter,
+        CreateWithPublicKey(
+            kTestCurveId, max_counter_value,
+            {.u = public_key_pair.first, .e = public_key_pair.second}));
+    Sketch plain_sketch;
+    *plain_sketch.mutable_config() =
+        CreateSketchConfig(/* unique_cnt = */ 0, /* sum_cnt = */ 1);
+    const std::vector<int> values = {1, 2, 63, 64, max_counter_value,
+                                     max_counter_value + 1,
+                                     max_counter_value + 10};
+    for (int value : values) {
+      plain_sketch.add_registers()->add_values(value);
+    }
+
+    ASSERT_OK_AND_ASSIGN(
+        std::string result,
+        encrypter->Encrypt(plain_sketch,
+                           EncryptSketchRequest::CONFLICTING_KEYS));
+    std::vector<std::string> cipher_words = GetCipherStrings(result);
+    ASSERT_EQ(cipher_words.size(), 4 * values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      const int n = std::min(values[i], max_counter_value + 1);
+      SCOPED_TRACE(n);
+      ASSERT_OK_AND_ASSIGN(ECPoint expected_ec,
+                           unit_ec.Mul(context.CreateBigNum(n)));
+      ASSERT_OK_AND_ASSIGN(std::string expected,
+                           expected_ec.ToBytesCompressed());
+      EXPECT_THAT(original_cipher_->Decrypt(
+                      std::make_pair(cipher_words[4 * i + 2],
+                                     cipher_words[4 * i + 3])),
+                  IsOkAndHolds(expected));
+    }
+  }
+}
+
 TEST_F(SketchEncrypterTest, ZeroCountValueShouldThrow) {
   Sketch plain_sketch;
   *plain_sketch.mutable_config() =
@@ -373,6 +426,360 @@ TEST_F(SketchEncrypterTest, TestDestroyedRegistersUsingFlaggedKey) {
               IsEncryptionOf(original_cipher_.get(), "destroyed_register_key"));
 }
 
+TEST_F(SketchEncrypterTest, MultiThreadedEncryptionShouldMatchSingleThreaded) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 1, /* sum_cnt = */ 1);
+  for (int i = 0; i < 30; ++i) {
+    Sketch::Register* sketch_register = plain_sketch.add_registers();
+    sketch_register->set_index(i);
+    // Every third register is destroyed.
+    sketch_register->add_values(i % 3 == 0 ? -1 : i);
+    sketch_register->add_values(i % 5 + 1);
+  }
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> multi_threaded_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.num_threads = 4}));
+
+  for (auto strategy : {EncryptSketchRequest::CONFLICTING_KEYS,
+                        EncryptSketchRequest::FLAGGED_KEY}) {
+    ASSERT_OK_AND_ASSIGN(std::string expected,
+                         sketch_encrypter_->Encrypt(plain_sketch, strategy));
+    ASSERT_OK_AND_ASSIGN(
+        std::string result,
+        multi_threaded_encrypter->Encrypt(plain_sketch, strategy));
+
+    std::vector<std::string> expected_words = GetCipherStrings(expected);
+    std::vector<std::string> cipher_words = GetCipherStrings(result);
+    ASSERT_EQ(cipher_words.size(), expected_words.size());
+    for (size_t i = 0; i < cipher_words.size(); i += 2) {
+      CiphertextString ciphertext = {cipher_words[i], cipher_words[i + 1]};
+      CiphertextString expected_ciphertext = {expected_words[i],
+                                              expected_words[i + 1]};
+      EXPECT_THAT(ciphertext, HasSameDecryption(original_cipher_.get(),
+                                                expected_ciphertext));
+    }
+  }
+}
+
+TEST_F(SketchEncrypterTest, MultiThreadedEncryptionErrorShouldBeReturned) {
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> multi_threaded_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.num_threads = 4}));
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 0, /* sum_cnt = */ 1);
+  for (int i = 0; i < 10; ++i) {
+    plain_sketch.add_registers()->add_values(i == 7 ? 0 : 1);
+  }
+
+  EXPECT_THAT(multi_threaded_encrypter->Encrypt(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "should be positive"));
+}
+
+TEST_F(SketchEncrypterTest, NonPositiveNumThreadsShouldThrow) {
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+
+  EXPECT_THAT(CreateWithPublicKey(
+                  kTestCurveId, kMaxCounterValue,
+                  {.u = public_key_pair.first, .e = public_key_pair.second},
+                  {.num_threads = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument, "num_threads"));
+}
+
+TEST_F(SketchEncrypterTest, PrecomputedCounterPointsShouldMatchLazyOnes) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 0, /* sum_cnt = */ 1);
+  for (int value : {1, 2, 3, kMaxCounterValue, kMaxCounterValue + 1,
+                    kMaxCounterValue + 10}) {
+    plain_sketch.add_registers()->add_values(value);
+  }
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> precomputing_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.precompute_counter_points = true}));
+
+  ASSERT_OK_AND_ASSIGN(std::string expected,
+                       EncryptWithConflictingKeys(plain_sketch));
+  ASSERT_OK_AND_ASSIGN(
+      std::string result,
+      precomputing_encrypter->Encrypt(plain_sketch,
+                                      EncryptSketchRequest::CONFLICTING_KEYS));
+  std::vector<std::string> expected_words = GetCipherStrings(expected);
+  std::vector<std::string> cipher_words = GetCipherStrings(result);
+  ASSERT_EQ(cipher_words.size(), expected_words.size());
+  for (size_t i = 0; i < cipher_words.size(); i += 2) {
+    CiphertextString ciphertext = {cipher_words[i], cipher_words[i + 1]};
+    CiphertextString expected_ciphertext = {expected_words[i],
+                                            expected_words[i + 1]};
+    EXPECT_THAT(ciphertext,
+                HasSameDecryption(original_cipher_.get(), expected_ciphertext));
+  }
+}
+
+TEST_F(SketchEncrypterTest, PrecomputingTooManyCounterPointsShouldThrow) {
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+
+  EXPECT_THAT(CreateWithPublicKey(
+                  kTestCurveId, kMaxPrecomputedCounterValue + 1,
+                  {.u = public_key_pair.first, .e = public_key_pair.second},
+                  {.precompute_counter_points = true}),
+              StatusIs(absl::StatusCode::kInvalidArgument, "precomputed"));
+}
+
+TEST_F(SketchEncrypterTest, CachedIndexPointsShouldMatchHashedOnes) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 0, /* sum_cnt = */ 1);
+  plain_sketch.add_registers()->set_index(1);
+  plain_sketch.add_registers()->set_index(2);
+  for (Sketch::Register& reg : *plain_sketch.mutable_registers()) {
+    reg.add_values(1);
+  }
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(std::shared_ptr<IndexPointCache> cache,
+                       IndexPointCache::Create({.capacity = 10}));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> caching_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.index_point_cache = cache}));
+
+  ASSERT_OK_AND_ASSIGN(std::string expected,
+                       EncryptWithConflictingKeys(plain_sketch));
+  // The second encryption reads the points cached by the first one.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK_AND_ASSIGN(
+        std::string result,
+        caching_encrypter->Encrypt(plain_sketch,
+                                   EncryptSketchRequest::CONFLICTING_KEYS));
+    std::vector<std::string> expected_words = GetCipherStrings(expected);
+    std::vector<std::string> cipher_words = GetCipherStrings(result);
+    ASSERT_EQ(cipher_words.size(), expected_words.size());
+    for (size_t j = 0; j < cipher_words.size(); j += 2) {
+      CiphertextString ciphertext = {cipher_words[j], cipher_words[j + 1]};
+      CiphertextString expected_ciphertext = {expected_words[j],
+                                              expected_words[j + 1]};
+      EXPECT_THAT(ciphertext, HasSameDecryption(original_cipher_.get(),
+                                                expected_ciphertext));
+    }
+    EXPECT_EQ(cache->size(), 2);
+  }
+}
+
+TEST_F(SketchEncrypterTest, EncryptToStreamShouldMatchEncrypt) {
+  // Enough registers to be written in several chunks.
+  const int register_size = 5000;
+  Sketch plain_sketch;
+  for (int i = 0; i < register_size; ++i) {
+    plain_sketch.add_registers()->set_index(i);
+  }
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> multi_threaded_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.num_threads = 2}));
+
+  ASSERT_OK_AND_ASSIGN(std::string expected,
+                       EncryptWithConflictingKeys(plain_sketch));
+  std::string result;
+  google::protobuf::io::StringOutputStream output(&result);
+  size_t encrypted_size = 0;
+  ASSERT_THAT(multi_threaded_encrypter->EncryptToStream(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+                  /* publisher_noise_parameter = */ nullptr,
+                  [&](size_t size) {
+                    encrypted_size = size;
+                    return absl::OkStatus();
+                  },
+                  &output),
+              IsOk());
+
+  EXPECT_EQ(encrypted_size, expected.size());
+  std::vector<std::string> expected_words = GetCipherStrings(expected);
+  std::vector<std::string> cipher_words = GetCipherStrings(result);
+  ASSERT_EQ(cipher_words.size(), expected_words.size());
+  for (size_t i = 0; i < cipher_words.size(); i += 2) {
+    CiphertextString ciphertext = {cipher_words[i], cipher_words[i + 1]};
+    CiphertextString expected_ciphertext = {expected_words[i],
+                                            expected_words[i + 1]};
+    EXPECT_THAT(ciphertext,
+                HasSameDecryption(original_cipher_.get(), expected_ciphertext));
+  }
+}
+
+TEST_F(SketchEncrypterTest, EncryptToStreamShouldAppendNoiseRegisters) {
+  const int values_per_register = 2;
+  const int ciphertexts_per_register = (values_per_register + 1) * 2;
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() = CreateSketchConfig(
+      /* unique_cnt = */ values_per_register, /* sum_cnt = */ 0);
+  AddRandomRegisters(/* register_cnt = */ 10, plain_sketch);
+  EncryptSketchRequest::PublisherNoiseParameter noise_parameter;
+  noise_parameter.set_epsilon(1);
+  noise_parameter.set_delta(0.1);
+  noise_parameter.set_publisher_count(3);
+
+  std::string result;
+  google::protobuf::io::StringOutputStream output(&result);
+  size_t encrypted_size = 0;
+  ASSERT_THAT(sketch_encrypter_->EncryptToStream(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+                  &noise_parameter,
+                  [&](size_t size) {
+                    encrypted_size = size;
+                    return absl::OkStatus();
+                  },
+                  &output),
+              IsOk());
+
+  EXPECT_EQ(result.size(), encrypted_size);
+  std::vector<std::string> cipher_words = GetCipherStrings(result);
+  ASSERT_EQ(cipher_words.size() % ciphertexts_per_register, 0);
+  ASSERT_GT(cipher_words.size(), 10 * ciphertexts_per_register);
+  for (size_t i = 10 * ciphertexts_per_register; i < cipher_words.size();
+       i += ciphertexts_per_register) {
+    CiphertextString index = {cipher_words[i], cipher_words[i + 1]};
+    EXPECT_THAT(index, IsEncryptionOf(original_cipher_.get(),
+                                      "publisher_noise_register_id"));
+  }
+}
+
+TEST_F(SketchEncrypterTest, EncryptToStreamSizeErrorShouldBeReturned) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 1, /* sum_cnt = */ 1);
+  AddRandomRegisters(/* register_cnt = */ 2, plain_sketch);
+
+  std::string result;
+  google::protobuf::io::StringOutputStream output(&result);
+  EXPECT_THAT(sketch_encrypter_->EncryptToStream(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+                  /* publisher_noise_parameter = */ nullptr,
+                  [](size_t size) {
+                    return absl::ResourceExhaustedError("too large");
+                  },
+                  &output),
+              StatusIs(absl::StatusCode::kResourceExhausted, "too large"));
+  EXPECT_THAT(result, SizeIs(0));
+}
+
+TEST_F(SketchEncrypterTest, EstimatedSizeShouldBeExactWithoutNoise) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 1, /* sum_cnt = */ 2);
+  AddRandomRegisters(/* register_cnt = */ 3, plain_sketch);
+  // A destroyed register is encrypted as two registers with CONFLICTING_KEYS.
+  plain_sketch.mutable_registers(1)->set_values(0, -1);
+
+  for (auto strategy : {EncryptSketchRequest::CONFLICTING_KEYS,
+                        EncryptSketchRequest::FLAGGED_KEY}) {
+    ASSERT_OK_AND_ASSIGN(std::string encrypted_sketch,
+                         sketch_encrypter_->Encrypt(plain_sketch, strategy));
+    EXPECT_THAT(sketch_encrypter_->EstimateEncryptedSize(
+                    plain_sketch, strategy,
+                    /* publisher_noise_parameter = */ nullptr),
+                IsOkAndHolds(encrypted_sketch.size()));
+  }
+}
+
+TEST_F(SketchEncrypterTest, EncryptIntoBufferShouldMatchEncrypt) {
+  const int values_per_register = 2;
+  const int bytes_per_register = (values_per_register + 1) * 66;
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() = CreateSketchConfig(
+      /* unique_cnt = */ 1, /* sum_cnt = */ values_per_register - 1);
+  AddRandomRegisters(/* register_cnt = */ 5, plain_sketch);
+  EncryptSketchRequest::PublisherNoiseParameter noise_parameter;
+  noise_parameter.set_epsilon(1);
+  noise_parameter.set_delta(0.1);
+  noise_parameter.set_publisher_count(3);
+
+  ASSERT_OK_AND_ASSIGN(
+      size_t max_size,
+      sketch_encrypter_->EstimateEncryptedSize(
+          plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+          &noise_parameter));
+  ASSERT_OK_AND_ASSIGN(std::string expected,
+                       EncryptWithConflictingKeys(plain_sketch));
+  ASSERT_GE(max_size, expected.size());
+  std::string buffer(max_size, '\0');
+  ASSERT_OK_AND_ASSIGN(
+      size_t size,
+      sketch_encrypter_->Encrypt(plain_sketch,
+                                 EncryptSketchRequest::CONFLICTING_KEYS,
+                                 &noise_parameter, absl::MakeSpan(buffer)));
+
+  ASSERT_LE(size, max_size);
+  EXPECT_EQ((size - expected.size()) % bytes_per_register, 0);
+  std::vector<std::string> expected_words = GetCipherStrings(expected);
+  std::vector<std::string> cipher_words =
+      GetCipherStrings(absl::string_view(buffer).substr(0, size));
+  ASSERT_GE(cipher_words.size(), expected_words.size());
+  for (size_t i = 0; i < expected_words.size(); i += 2) {
+    CiphertextString ciphertext = {cipher_words[i], cipher_words[i + 1]};
+    CiphertextString expected_ciphertext = {expected_words[i],
+                                            expected_words[i + 1]};
+    EXPECT_THAT(ciphertext,
+                HasSameDecryption(original_cipher_.get(), expected_ciphertext));
+  }
+  for (size_t i = expected_words.size(); i < cipher_words.size();
+       i += bytes_per_register / 33) {
+    CiphertextString index = {cipher_words[i], cipher_words[i + 1]};
+    EXPECT_THAT(index, IsEncryptionOf(original_cipher_.get(),
+                                      "publisher_noise_register_id"));
+  }
+}
+
+TEST_F(SketchEncrypterTest, EncryptIntoTooSmallBufferShouldThrow) {
+  Sketch plain_sketch;
+  *plain_sketch.mutable_config() =
+      CreateSketchConfig(/* unique_cnt = */ 1, /* sum_cnt = */ 1);
+  AddRandomRegisters(/* register_cnt = */ 2, plain_sketch);
+  std::string buffer(5 * 66, '\0');
+
+  EXPECT_THAT(sketch_encrypter_->Encrypt(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+                  /* publisher_noise_parameter = */ nullptr,
+                  absl::MakeSpan(buffer)),
+              StatusIs(absl::StatusCode::kInvalidArgument, "buffer"));
+
+  // Large enough for the registers, but not for the noise.
+  EncryptSketchRequest::PublisherNoiseParameter noise_parameter;
+  noise_parameter.set_epsilon(1);
+  noise_parameter.set_delta(0.1);
+  noise_parameter.set_publisher_count(3);
+  buffer.resize(6 * 66);
+  EXPECT_THAT(sketch_encrypter_->Encrypt(
+                  plain_sketch, EncryptSketchRequest::CONFLICTING_KEYS,
+                  &noise_parameter, absl::MakeSpan(buffer)),
+              StatusIs(absl::StatusCode::kInvalidArgument, "buffer"));
+}
+
 TEST_F(SketchEncrypterTest, CombineElGamalPublicKeysNormalCases) {
   ElGamalPublicKey key1;
   key1.set_generator(absl::HexStringToBytes(kElGamalPublicKeyG));
@@ -417,6 +824,85 @@ TEST_F(SketchEncrypterTest, CombineElGamalPublicKeysInvalidInputShouldThrow) {
               StatusIs(absl::StatusCode::kInvalidArgument, "Invalid ECPoint"));
 }
 
+TEST_F(SketchEncrypterTest, CombineElGamalPublicKeysMultiThreadedCases) {
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(ECGroup ec_group, ECGroup::Create(kTestCurveId, &ctx));
+  std::vector<ElGamalPublicKey> keys;
+  for (int i = 0; i < 11; ++i) {
+    ASSERT_OK_AND_ASSIGN(ECPoint element,
+                         ec_group.GetPointByHashingToCurveSha256(
+                             absl::StrCat("key", i)));
+    ElGamalPublicKey& key = keys.emplace_back();
+    key.set_generator(absl::HexStringToBytes(kElGamalPublicKeyG));
+    ASSERT_OK_AND_ASSIGN(*key.mutable_element(), element.ToBytesCompressed());
+  }
+
+  ASSERT_OK_AND_ASSIGN(ElGamalPublicKey expected,
+                       CombineElGamalPublicKeys(kTestCurveId, keys));
+  for (int num_threads : {2, 3, 4, 11, 20}) {
+    EXPECT_THAT(CombineElGamalPublicKeys(kTestCurveId, keys, num_threads),
+                IsOkAndHolds(EqualsProto(expected)));
+  }
+}
+
+TEST_F(SketchEncrypterTest,
+       CombineElGamalPublicKeysWithOppositeKeysInOneRange) {
+  Context ctx;
+  ASSERT_OK_AND_ASSIGN(ECGroup ec_group, ECGroup::Create(kTestCurveId, &ctx));
+  ASSERT_OK_AND_ASSIGN(ECPoint p,
+                       ec_group.GetPointByHashingToCurveSha256("P"));
+  ASSERT_OK_AND_ASSIGN(ECPoint q,
+                       ec_group.GetPointByHashingToCurveSha256("Q"));
+  ASSERT_OK_AND_ASSIGN(ECPoint r,
+                       ec_group.GetPointByHashingToCurveSha256("R"));
+  ASSERT_OK_AND_ASSIGN(ECPoint minus_p, p.Inverse());
+  ASSERT_OK_AND_ASSIGN(ECPoint minus_q, q.Inverse());
+  auto to_keys = [](const std::vector<const ECPoint*>& elements)
+      -> absl::StatusOr<std::vector<ElGamalPublicKey>> {
+    std::vector<ElGamalPublicKey> keys;
+    for (const ECPoint* element : elements) {
+      ElGamalPublicKey& key = keys.emplace_back();
+      key.set_generator(absl::HexStringToBytes(kElGamalPublicKeyG));
+      ASSIGN_OR_RETURN(*key.mutable_element(), element->ToBytesCompressed());
+    }
+    return keys;
+  };
+
+  // With 2 threads, the keys P and -P are summed on the same one.
+  ASSERT_OK_AND_ASSIGN(std::vector<ElGamalPublicKey> keys,
+                       to_keys({&p, &minus_p, &q, &r}));
+  ASSERT_OK_AND_ASSIGN(ECPoint q_plus_r, q.Add(r));
+  ElGamalPublicKey expected;
+  expected.set_generator(absl::HexStringToBytes(kElGamalPublicKeyG));
+  ASSERT_OK_AND_ASSIGN(*expected.mutable_element(),
+                       q_plus_r.ToBytesCompressed());
+  for (int num_threads : {1, 2, 4}) {
+    EXPECT_THAT(CombineElGamalPublicKeys(kTestCurveId, keys, num_threads),
+                IsOkAndHolds(EqualsProto(expected)));
+  }
+
+  ASSERT_OK_AND_ASSIGN(keys, to_keys({&p, &q, &minus_p, &minus_q}));
+  for (int num_threads : {1, 2, 4}) {
+    EXPECT_THAT(CombineElGamalPublicKeys(kTestCurveId, keys, num_threads),
+                StatusIs(absl::StatusCode::kInvalidArgument, "infinity"));
+  }
+}
+
+TEST_F(SketchEncrypterTest,
+       CombineElGamalPublicKeysMultiThreadedInvalidInputShouldThrow) {
+  std::vector<ElGamalPublicKey> keys(5);
+  for (ElGamalPublicKey& key : keys) {
+    key.set_generator(absl::HexStringToBytes(kElGamalPublicKeyG));
+    key.set_element(absl::HexStringToBytes(kElGamalPublicKeyY1));
+  }
+  keys[3].set_generator("foo");
+
+  EXPECT_THAT(CombineElGamalPublicKeys(kTestCurveId, keys, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument, "Generators"));
+  EXPECT_THAT(CombineElGamalPublicKeys(kTestCurveId, keys, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument, "num_threads"));
+}
+
 TEST_F(SketchEncrypterTest, NoisesShouldHaveTheSameIndex) {
   Context ctx;
   ASSERT_OK_AND_ASSIGN(ECGroup ec_group, ECGroup::Create(kTestCurveId, &ctx));
@@ -449,5 +935,51 @@ TEST_F(SketchEncrypterTest, NoisesShouldHaveTheSameIndex) {
   }
 }
 
+TEST_F(SketchEncrypterTest, MultiThreadedNoiseRegistersShouldBeValid) {
+  const int values_per_register = 2;
+  const int ciphertexts_per_register = (values_per_register + 1) * 2;
+  ASSERT_OK_AND_ASSIGN(auto public_key_pair,
+                       original_cipher_->GetPublicKeyBytes());
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SketchEncrypter> multi_threaded_encrypter,
+      CreateWithPublicKey(
+          kTestCurveId, kMaxCounterValue,
+          {.u = public_key_pair.first, .e = public_key_pair.second},
+          {.num_threads = 3}));
+  EncryptSketchRequest::PublisherNoiseParameter noise_parameter;
+  noise_parameter.set_epsilon(1);
+  noise_parameter.set_delta(0.1);
+  noise_parameter.set_publisher_count(3);
+
+  std::string encrypted_sketch;
+  ASSERT_THAT(multi_threaded_encrypter->AppendNoiseRegisters(
+                  noise_parameter, values_per_register, encrypted_sketch),
+              IsOk());
+
+  std::vector<std::string> cipher_words = GetCipherStrings(encrypted_sketch);
+  ASSERT_EQ(cipher_words.size() % ciphertexts_per_register, 0);
+  ASSERT_GT(cipher_words.size(), 0);
+  std::vector<std::string> random_values;
+  for (size_t i = 0; i < cipher_words.size(); i += ciphertexts_per_register) {
+    CiphertextString index = {cipher_words[i], cipher_words[i + 1]};
+    EXPECT_THAT(index, IsEncryptionOf(original_cipher_.get(),
+                                      "publisher_noise_register_id"));
+    // All the values of a noise register are the same random value.
+    ASSERT_OK_AND_ASSIGN(std::string random_value,
+                         original_cipher_->Decrypt(std::make_pair(
+                             cipher_words[i + 2], cipher_words[i + 3])));
+    for (int j = 1; j < values_per_register; ++j) {
+      const size_t value_i = i + 2 * (j + 1);
+      EXPECT_THAT(original_cipher_->Decrypt(std::make_pair(
+                      cipher_words[value_i], cipher_words[value_i + 1])),
+                  IsOkAndHolds(random_value));
+    }
+    random_values.push_back(random_value);
+  }
+  std::sort(random_values.begin(), random_values.end());
+  EXPECT_EQ(std::adjacent_find(random_values.begin(), random_values.end()),
+            random_values.end());
+}
+
 }  // namespace
 }  // namespace wfa::any_sketch::crypto
@@ -14,13 +14,29 @@
 
 #include "any_sketch/distributions.h"
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "common_cpp/testing/status_macros.h"
 #include "common_cpp/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace wfa::any_sketch {
 namespace {
+using ::testing::Each;
+using ::testing::ElementsAre;
+
 class FakeFingerprinter : public Fingerprinter {
  public:
   uint64_t Fingerprint(absl::Span<const unsigned char> item) const override {
@@ -74,6 +90,52 @@ TEST(DistributionsTest, UniformDistribution) {
   EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(3));
 }
 
+TEST(DistributionsTest, UniformModuloMatchesDivision) {
+  FakeFingerprinter fingerprinter;
+  std::mt19937_64 random(42);
+  std::vector<uint64_t> fingerprints = {0, 1, 2, 1000,
+                                        std::numeric_limits<uint64_t>::max()};
+  for (int i = 0; i < 1000; ++i) {
+    fingerprints.push_back(random());
+  }
+  for (int64_t size : {int64_t{1}, int64_t{2}, int64_t{3}, int64_t{7},
+                       int64_t{1000}, int64_t{1} << 40, (int64_t{1} << 40) + 1,
+                       std::numeric_limits<int64_t>::max()}) {
+    std::unique_ptr<BaseDistribution> distribution =
+        GetUniformDistribution(&fingerprinter, -5, size - 6);
+    std::vector<int64_t> values(fingerprints.size());
+    ASSERT_THAT(
+        distribution->ApplyToFingerprints(fingerprints, absl::MakeSpan(values)),
+        IsOk());
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+      const int64_t expected = fingerprints[i] % size - 5;
+      EXPECT_EQ(values[i], expected) << fingerprints[i] << " % " << size;
+      fingerprinter.SetFingerprint(fingerprints[i]);
+      EXPECT_THAT(distribution->Apply("irrelevant", {}),
+                  IsOkAndHolds(expected));
+    }
+  }
+}
+
+TEST(DistributionsTest, UniformMultiplyShift) {
+  FakeFingerprinter fingerprinter;
+  std::unique_ptr<BaseDistribution> distribution = GetUniformDistribution(
+      &fingerprinter, 3, 10, RangeReduction::kMultiplyShift);
+  std::vector<uint64_t> fingerprints = {0, uint64_t{1} << 61,
+                                        uint64_t{3} << 62,
+                                        std::numeric_limits<uint64_t>::max()};
+  std::vector<int64_t> values(fingerprints.size());
+
+  ASSERT_THAT(
+      distribution->ApplyToFingerprints(fingerprints, absl::MakeSpan(values)),
+      IsOk());
+  EXPECT_THAT(values, ElementsAre(3, 4, 9, 10));
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    fingerprinter.SetFingerprint(fingerprints[i]);
+    EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(values[i]));
+  }
+}
+
 TEST(DistributionsTest, ExponentialDistribution) {
   FakeFingerprinter fingerprinter;
   std::unique_ptr<BaseDistribution> distribution =
@@ -92,6 +154,107 @@ TEST(DistributionsTest, ExponentialDistribution) {
   EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(1335));
 }
 
+TEST(DistributionsTest, ExponentialApplyToFingerprintsMatchesApply) {
+  constexpr uint64_t kMaxFingerprint = std::numeric_limits<uint64_t>::max();
+  FakeFingerprinter fingerprinter;
+  std::mt19937_64 random(42);
+  for (auto [rate, size] : std::vector<std::pair<double, int64_t>>{
+           {2, 10}, {10, 1000}, {23, 100000}}) {
+    std::unique_ptr<BaseDistribution> distribution =
+        GetExponentialDistribution(&fingerprinter, rate, size);
+    std::vector<uint64_t> fingerprints = {0, 1, kMaxFingerprint - 1,
+                                          kMaxFingerprint};
+    for (int i = 0; i < 10000; ++i) {
+      fingerprints.push_back(random());
+    }
+    // Fingerprints close to where the value changes.
+    for (int64_t value = 1; value < size; value += (size + 99) / 100) {
+      const double x = static_cast<double>(value) / size;
+      const double u =
+          (std::exp(rate * (1 - x)) - std::exp(rate)) / (1 - std::exp(rate));
+      const uint64_t center = static_cast<uint64_t>(
+          u * static_cast<double>(uint64_t{1} << 63) * 2);
+      for (uint64_t offset : {uint64_t{0}, uint64_t{1}, uint64_t{1} << 10,
+                              uint64_t{1} << 20, uint64_t{1} << 30}) {
+        fingerprints.push_back(center - offset);
+        fingerprints.push_back(center + offset);
+      }
+    }
+
+    // A batch fails if any of its values is out of range, so those are
+    // checked on their own.
+    std::vector<uint64_t> in_range_fingerprints;
+    std::vector<int64_t> expected_values;
+    for (uint64_t fingerprint : fingerprints) {
+      fingerprinter.SetFingerprint(fingerprint);
+      absl::StatusOr<int64_t> expected = distribution->Apply("irrelevant", {});
+      if (expected.ok()) {
+        in_range_fingerprints.push_back(fingerprint);
+        expected_values.push_back(*expected);
+      } else {
+        int64_t value;
+        EXPECT_THAT(distribution->ApplyToFingerprints(
+                        absl::MakeConstSpan(&fingerprint, 1),
+                        absl::MakeSpan(&value, 1)),
+                    IsNotOk());
+      }
+    }
+    std::vector<int64_t> values(in_range_fingerprints.size());
+    ASSERT_THAT(distribution->ApplyToFingerprints(in_range_fingerprints,
+                                                  absl::MakeSpan(values)),
+                IsOk());
+    EXPECT_EQ(values, expected_values);
+  }
+}
+
+TEST(DistributionsTest, ExponentialTablesAreSharedAcrossThreads) {
+  const std::vector<std::pair<double, int64_t>> parameters = {
+      {2, 1000}, {2, 1000}, {10, 1000}, {10, 1000}};
+  FakeFingerprinter fingerprinter;
+  std::mt19937_64 random(7);
+  std::vector<uint64_t> fingerprints(1000);
+  for (uint64_t& fingerprint : fingerprints) {
+    fingerprint = random();
+  }
+  std::vector<std::vector<int64_t>> expected_values;
+  for (auto [rate, size] : parameters) {
+    std::unique_ptr<BaseDistribution> distribution =
+        GetExponentialDistribution(&fingerprinter, rate, size);
+    std::vector<int64_t>& expected = expected_values.emplace_back();
+    for (uint64_t fingerprint : fingerprints) {
+      fingerprinter.SetFingerprint(fingerprint);
+      ASSERT_OK_AND_ASSIGN(int64_t value,
+                           distribution->Apply("irrelevant", {}));
+      expected.push_back(value);
+    }
+  }
+
+  // The tables are released with the last distribution that holds them, so
+  // the second round builds them again.
+  for (int round = 0; round < 2; ++round) {
+    std::vector<std::vector<int64_t>> values(
+        parameters.size(), std::vector<int64_t>(fingerprints.size()));
+    std::vector<absl::Status> statuses(parameters.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+      threads.emplace_back([&, i]() {
+        std::unique_ptr<BaseDistribution> distribution =
+            GetExponentialDistribution(&fingerprinter, parameters[i].first,
+                                       parameters[i].second);
+        statuses[i] = distribution->ApplyToFingerprints(
+            fingerprints, absl::MakeSpan(values[i]));
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (size_t i = 0; i < parameters.size(); ++i) {
+      EXPECT_THAT(statuses[i], IsOk());
+      EXPECT_EQ(values[i], expected_values[i]);
+    }
+  }
+}
+
 TEST(DistributionsTest, GeometricDistribution) {
   FakeFingerprinter fingerprinter;
   std::unique_ptr<BaseDistribution> distribution =
@@ -111,5 +274,166 @@ TEST(DistributionsTest, GeometricDistribution) {
   fingerprinter.SetFingerprint(0b11110000);
   EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(14));
 }
+
+TEST(DistributionsTest, GeometricApplyToFingerprintsMatchesApply) {
+  FakeFingerprinter fingerprinter;
+  std::unique_ptr<BaseDistribution> distribution =
+      GetGeometricDistribution(&fingerprinter, 3, 40);
+  std::vector<uint64_t> fingerprints = {0, 1, 0b1000, uint64_t{1} << 36,
+                                        uint64_t{1} << 37, uint64_t{1} << 63};
+  std::vector<int64_t> values(fingerprints.size());
+
+  ASSERT_THAT(
+      distribution->ApplyToFingerprints(fingerprints, absl::MakeSpan(values)),
+      IsOk());
+  EXPECT_THAT(values, ElementsAre(40, 3, 6, 39, 40, 40));
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    fingerprinter.SetFingerprint(fingerprints[i]);
+    EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(values[i]));
+  }
+}
+
+TEST(DistributionsTest, ConstantDistribution) {
+  std::unique_ptr<BaseDistribution> distribution = GetConstantDistribution(7);
+
+  EXPECT_EQ(distribution->min_value(), 7);
+  EXPECT_EQ(distribution->max_value(), 7);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(7));
+}
+
+TEST(DistributionsTest, VerbatimDistribution) {
+  FakeFingerprinter fingerprinter;
+  std::vector<double> probabilities = {0.25, 0, 0.75};
+  std::unique_ptr<BaseDistribution> distribution =
+      GetVerbatimDistribution(&fingerprinter, probabilities);
+
+  EXPECT_EQ(distribution->min_value(), 0);
+  EXPECT_EQ(distribution->max_value(), 2);
+
+  // The first quarter of the fingerprints map to 0 and the rest to 2.
+  fingerprinter.SetFingerprint(0);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(0));
+  fingerprinter.SetFingerprint((uint64_t{1} << 62) - 1);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(0));
+  fingerprinter.SetFingerprint(uint64_t{1} << 62);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(2));
+  fingerprinter.SetFingerprint(std::numeric_limits<uint64_t>::max());
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(2));
+}
+
+TEST(DistributionsTest, DiracMixtureDistribution) {
+  FakeFingerprinter fingerprinter;
+  std::vector<DiracDelta> deltas = {{.alpha = 0.5, .activity = 1},
+                                    {.alpha = 0.5, .activity = 3}};
+  std::unique_ptr<BaseDistribution> distribution =
+      GetDiracMixtureDistribution(&fingerprinter, deltas, 8);
+
+  EXPECT_EQ(distribution->min_value(), 0);
+  EXPECT_EQ(distribution->max_value(), 7);
+
+  // The first pool holds values 0 to 3 and is picked for the first quarter of
+  // the fingerprints. The second holds values 4 to 7.
+  fingerprinter.SetFingerprint(0);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(0));
+  fingerprinter.SetFingerprint((uint64_t{1} << 62) - 1);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(3));
+  fingerprinter.SetFingerprint(uint64_t{1} << 62);
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(4));
+  fingerprinter.SetFingerprint(std::numeric_limits<uint64_t>::max());
+  EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(7));
+}
+
+TEST(DistributionsTest, ApplyToFingerprintsMatchesApply) {
+  FakeFingerprinter fingerprinter;
+  std::unique_ptr<BaseDistribution> distribution =
+      GetUniformDistribution(&fingerprinter, 3, 10);
+  ASSERT_EQ(distribution->fingerprinter(), &fingerprinter);
+
+  std::vector<uint64_t> fingerprints = {0, 3, 8, 100};
+  std::vector<int64_t> values(fingerprints.size());
+  ASSERT_THAT(distribution->ApplyToFingerprints(fingerprints,
+                                                absl::MakeSpan(values)),
+              IsOk());
+  for (size_t i = 0; i < fingerprints.size(); ++i) {
+    fingerprinter.SetFingerprint(fingerprints[i]);
+    EXPECT_THAT(distribution->Apply("irrelevant", {}), IsOkAndHolds(values[i]));
+  }
+}
+
+TEST(DistributionsTest, OracleDistributionHasNoFingerprinter) {
+  std::unique_ptr<BaseDistribution> distribution =
+      GetOracleDistribution("foo", 3, 10);
+  std::vector<uint64_t> fingerprints = {0};
+  std::vector<int64_t> values(1);
+
+  EXPECT_EQ(distribution->fingerprinter(), nullptr);
+  EXPECT_THAT(distribution->ApplyToFingerprints(fingerprints,
+                                                absl::MakeSpan(values)),
+              IsNotOk());
+}
+
+TEST(DistributionsTest, OracleDistributionApplyToFeatureValues) {
+  std::unique_ptr<BaseDistribution> distribution =
+      GetOracleDistribution("foo", 3, 10);
+  std::vector<int64_t> values(2);
+
+  EXPECT_EQ(distribution->oracle_feature_name(), "foo");
+  ASSERT_THAT(distribution->ApplyToFeatureValues(std::vector<int64_t>{5, 7},
+                                                 absl::MakeSpan(values)),
+              IsOk());
+  EXPECT_THAT(values, ElementsAre(5, 7));
+  EXPECT_THAT(distribution->ApplyToFeatureValues(std::vector<int64_t>{5, 11},
+                                                 absl::MakeSpan(values)),
+              IsNotOk());
+
+  std::unique_ptr<BaseDistribution> constant = GetConstantDistribution(4);
+  EXPECT_EQ(constant->oracle_feature_name(), std::nullopt);
+  EXPECT_THAT(constant->ApplyToFeatureValues(std::vector<int64_t>{5, 7},
+                                             absl::MakeSpan(values)),
+              IsNotOk());
+}
+
+TEST(DistributionsTest, ApplyBatchMatchesApply) {
+  FakeFingerprinter fingerprinter;
+  fingerprinter.SetFingerprint(12345);
+  std::vector<std::unique_ptr<BaseDistribution>> distributions;
+  distributions.push_back(GetUniformDistribution(&fingerprinter, 3, 10));
+  distributions.push_back(GetExponentialDistribution(&fingerprinter, 2, 10));
+  distributions.push_back(GetGeometricDistribution(&fingerprinter, 10, 74));
+  std::vector<absl::string_view> items = {"a", "b", "c"};
+
+  for (const auto& distribution : distributions) {
+    std::vector<int64_t> values(items.size());
+    ASSERT_THAT(distribution->ApplyBatch(items, {}, absl::MakeSpan(values)),
+                IsOk());
+    ASSERT_OK_AND_ASSIGN(int64_t expected, distribution->Apply("a", {}));
+    EXPECT_THAT(values, Each(expected));
+  }
+}
+
+TEST(DistributionsTest, OracleDistributionApplyBatch) {
+  std::unique_ptr<BaseDistribution> distribution =
+      GetOracleDistribution("foo", 3, 10);
+  std::vector<absl::string_view> items = {"a", "b"};
+  std::vector<int64_t> values(items.size());
+
+  std::vector<ItemMetadata> item_metadata = {{{"foo", 5}}, {{"foo", 7}}};
+  ASSERT_THAT(
+      distribution->ApplyBatch(items, item_metadata, absl::MakeSpan(values)),
+      IsOk());
+  EXPECT_THAT(values, ElementsAre(5, 7));
+
+  std::vector<ItemMetadata> out_of_range = {{{"foo", 5}}, {{"foo", 11}}};
+  EXPECT_THAT(
+      distribution->ApplyBatch(items, out_of_range, absl::MakeSpan(values)),
+      IsNotOk());
+  EXPECT_THAT(distribution->ApplyBatch(items, {}, absl::MakeSpan(values)),
+              IsNotOk());
+
+  std::vector<ItemMetadata> too_few_metadata = {{{"foo", 5}}};
+  EXPECT_THAT(
+      distribution->ApplyBatch(items, too_few_metadata, absl::MakeSpan(values)),
+      IsNotOk());
+}
 }  // namespace
 }  // namespace wfa::any_sketch
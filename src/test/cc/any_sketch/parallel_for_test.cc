@@ -0,0 +1,60 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/parallel_for.h"
+
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace wfa::any_sketch {
+namespace {
+using ::testing::Each;
+
+TEST(ParallelForTest, RunsEveryTaskOnce) {
+  for (int num_threads : {1, 3, 16}) {
+    std::vector<int> calls(10, 0);
+    ASSERT_THAT(ParallelFor(num_threads, calls.size(),
+                            [&](int i) {
+                              ++calls[i];
+                              return absl::OkStatus();
+                            }),
+                IsOk());
+    EXPECT_THAT(calls, Each(1));
+  }
+}
+
+TEST(ParallelForTest, ReturnsErrorOfFirstFailedTask) {
+  std::vector<int> calls(10, 0);
+  absl::Status status = ParallelFor(4, calls.size(), [&](int i) {
+    ++calls[i];
+    return i % 3 == 2 ? absl::InternalError(absl::StrCat("task ", i))
+                      : absl::OkStatus();
+  });
+
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kInternal, "task 2"));
+  EXPECT_THAT(calls, Each(1));
+}
+
+TEST(ParallelForTest, NoTasks) {
+  EXPECT_THAT(ParallelFor(4, 0, [](int) { return absl::InternalError(""); }),
+              IsOk());
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch
@@ -0,0 +1,130 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sharded_any_sketch_builder.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/distributions.h"
+#include "any_sketch/value_function.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace wfa::any_sketch {
+namespace {
+using ::testing::IsEmpty;
+
+constexpr int64_t kNumIndexes = 10000;
+
+std::unique_ptr<AnySketch> MakeSketch(const AnySketchOptions& options) {
+  const Fingerprinter* fingerprinter = &GetFarmFingerprinter();
+  std::vector<std::unique_ptr<BaseDistribution>> indexes;
+  indexes.push_back(
+      GetUniformDistribution(fingerprinter, 0, kNumIndexes - 1));
+  std::vector<ValueFunction> values;
+  values.push_back({.name = "Frequency",
+                    .aggregator_type = AggregatorType::kSum,
+                    .distribution = GetOracleDistribution("frequency", 1, 10)});
+  values.push_back({.name = "Key",
+                    .aggregator_type = AggregatorType::kUnique,
+                    .distribution = GetUniformDistribution(fingerprinter, 0,
+                                                           1000000)});
+  return absl::make_unique<AnySketch>(std::move(indexes), std::move(values),
+                                      options);
+}
+
+absl::flat_hash_map<uint64_t, std::vector<int64_t>> GetRegisterMap(
+    const AnySketch& sketch) {
+  absl::flat_hash_map<uint64_t, std::vector<int64_t>> registers;
+  for (const AnySketch::Register& reg : sketch) {
+    registers[reg.index].assign(reg.values.begin(), reg.values.end());
+  }
+  return registers;
+}
+
+class ShardedAnySketchBuilderTest
+    : public ::testing::TestWithParam<uint64_t /* max_dense_index_space */> {
+ protected:
+  AnySketchOptions options() const {
+    return {.max_dense_index_space = GetParam()};
+  }
+};
+
+TEST_P(ShardedAnySketchBuilderTest, MatchesSerialInsertion) {
+  std::vector<uint64_t> items;
+  std::vector<ItemMetadata> item_metadata;
+  for (uint64_t item = 0; item < 20000; ++item) {
+    // Repeat some items so that registers aggregate.
+    items.push_back(item % 15000);
+    item_metadata.push_back(
+        {{"frequency", 1 + static_cast<int64_t>(item % 3)}});
+  }
+
+  std::unique_ptr<AnySketch> expected = MakeSketch(options());
+  ASSERT_THAT(expected->InsertBatch(items, item_metadata), IsOk());
+
+  ShardedAnySketchBuilder builder(
+      4, [this]() { return MakeSketch(options()); });
+  absl::Span<const uint64_t> all_items = items;
+  absl::Span<const ItemMetadata> all_metadata = item_metadata;
+  ASSERT_THAT(builder.InsertBatch(all_items.subspan(0, 12345),
+                                  all_metadata.subspan(0, 12345)),
+              IsOk());
+  ASSERT_THAT(builder.InsertBatch(all_items.subspan(12345),
+                                  all_metadata.subspan(12345)),
+              IsOk());
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<AnySketch> sketch, builder.Finalize());
+
+  EXPECT_EQ(sketch->is_dense(), expected->is_dense());
+  EXPECT_EQ(sketch->num_registers(), expected->num_registers());
+  EXPECT_EQ(GetRegisterMap(*sketch), GetRegisterMap(*expected));
+}
+
+TEST_P(ShardedAnySketchBuilderTest, FailedBatchLeavesSketchUnchanged) {
+  ShardedAnySketchBuilder builder(
+      3, [this]() { return MakeSketch(options()); });
+  std::vector<uint64_t> items = {1, 2, 3, 4, 5, 6};
+  std::vector<ItemMetadata> item_metadata(items.size(), {{"frequency", 1}});
+  item_metadata.back() = {{"wrong-key", 1}};
+
+  EXPECT_THAT(builder.InsertBatch(items, item_metadata), IsNotOk());
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<AnySketch> sketch, builder.Finalize());
+  EXPECT_EQ(sketch->num_registers(), 0);
+}
+
+TEST_P(ShardedAnySketchBuilderTest, CannotInsertAfterFinalize) {
+  ShardedAnySketchBuilder builder(
+      2, [this]() { return MakeSketch(options()); });
+  ASSERT_THAT(builder.Finalize(), IsOk());
+
+  std::vector<uint64_t> items = {1};
+  EXPECT_THAT(builder.InsertBatch(items, {{{"frequency", 1}}}), IsNotOk());
+  EXPECT_THAT(builder.Finalize(), IsNotOk());
+}
+
+INSTANTIATE_TEST_SUITE_P(DenseAndSparse, ShardedAnySketchBuilderTest,
+                         ::testing::Values(kNumIndexes, 0));
+
+}  // namespace
+}  // namespace wfa::any_sketch
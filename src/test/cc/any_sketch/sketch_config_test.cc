@@ -0,0 +1,191 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sketch_config.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/derived_fingerprinter.h"
+#include "any_sketch/distributions.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/testing/status_macros.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+namespace {
+using ::testing::AllOf;
+using ::testing::ElementsAre;
+using ::testing::Field;
+
+template <typename T>
+T ParseTextProto(absl::string_view text) {
+  T message;
+  EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(std::string(text),
+                                                            &message));
+  return message;
+}
+
+struct DistributionRangeTestCase {
+  std::string distribution;
+  int64_t min_value;
+  int64_t max_value;
+};
+
+class DistributionRangeTest
+    : public ::testing::TestWithParam<DistributionRangeTestCase> {};
+
+TEST_P(DistributionRangeTest, CreatesDistributionWithRange) {
+  Distribution config = ParseTextProto<Distribution>(GetParam().distribution);
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<BaseDistribution> distribution,
+                       CreateDistributionFromConfig(config));
+
+  EXPECT_EQ(distribution->min_value(), GetParam().min_value);
+  EXPECT_EQ(distribution->max_value(), GetParam().max_value);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllDistributions, DistributionRangeTest,
+    ::testing::Values(
+        DistributionRangeTestCase{
+            "exponential { rate: 10 num_values: 100 }", 0, 99},
+        DistributionRangeTestCase{"uniform { num_values: 8 salt: 'x' }", 0, 7},
+        DistributionRangeTestCase{
+            "uniform { num_values: 8 range_reduction: MULTIPLY_SHIFT }", 0, 7},
+        DistributionRangeTestCase{
+            "geometric { success_probability: 0.5 num_values: 8 }", 0, 7},
+        DistributionRangeTestCase{"constant { value: 3 }", 3, 3},
+        DistributionRangeTestCase{
+            "dirac_mixture { deltas { alpha: 0.25 activity: 1 } "
+            "deltas { alpha: 0.75 activity: 2 } num_values: 100 }",
+            0, 99},
+        DistributionRangeTestCase{
+            "verbatim { index_probability: [0.5, 0, 0.5] }", 0, 2},
+        DistributionRangeTestCase{"oracle { key: 'frequency' }", 0,
+                                  std::numeric_limits<int64_t>::max() - 1}));
+
+class InvalidDistributionTest : public ::testing::TestWithParam<std::string> {
+};
+
+TEST_P(InvalidDistributionTest, FailsToCreateDistribution) {
+  EXPECT_THAT(
+      CreateDistributionFromConfig(ParseTextProto<Distribution>(GetParam())),
+      IsNotOk());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    InvalidDistributions, InvalidDistributionTest,
+    ::testing::Values("", "exponential { rate: 0 num_values: 10 }",
+                      "uniform { num_values: 0 }",
+                      "geometric { success_probability: 0.1 num_values: 8 }",
+                      "dirac_mixture { num_values: 10 }",
+                      "dirac_mixture { deltas { alpha: 1 activity: 0 } "
+                      "num_values: 10 }",
+                      "verbatim { index_probability: [0, 0] }",
+                      "verbatim { index_probability: [1, -1] }"));
+
+TEST(SketchConfigTest, UniformDistributionRangeReduction) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<BaseDistribution> modulo,
+      CreateDistributionFromConfig(
+          ParseTextProto<Distribution>("uniform { num_values: 1000 }")));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<BaseDistribution> multiply_shift,
+      CreateDistributionFromConfig(ParseTextProto<Distribution>(
+          "uniform { num_values: 1000 range_reduction: MULTIPLY_SHIFT }")));
+  std::unique_ptr<BaseDistribution> expected_modulo =
+      GetUniformDistribution(&GetFarmFingerprinter(), 0, 999);
+  std::unique_ptr<BaseDistribution> expected_multiply_shift =
+      GetUniformDistribution(&GetFarmFingerprinter(), 0, 999,
+                             RangeReduction::kMultiplyShift);
+
+  for (absl::string_view item : {"a", "b", "c"}) {
+    ASSERT_OK_AND_ASSIGN(int64_t value, expected_modulo->Apply(item, {}));
+    EXPECT_THAT(modulo->Apply(item, {}), IsOkAndHolds(value));
+    ASSERT_OK_AND_ASSIGN(value, expected_multiply_shift->Apply(item, {}));
+    EXPECT_THAT(multiply_shift->Apply(item, {}), IsOkAndHolds(value));
+  }
+}
+
+TEST(SketchConfigTest, CreateAnySketchFromConfig) {
+  SketchConfig config = ParseTextProto<SketchConfig>(R"pb(
+    indexes {
+      name: "Index"
+      distribution { uniform { num_values: 1000 salt: "index" } }
+    }
+    values {
+      name: "Frequency"
+      distribution { oracle { key: "frequency" } }
+      aggregator: SUM
+    }
+    values {
+      name: "Count"
+      distribution { constant { value: 1 } }
+      aggregator: UNIQUE
+    }
+  )pb");
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<AnySketch> sketch,
+                       CreateAnySketchFromConfig(config));
+
+  EXPECT_TRUE(sketch->is_dense());
+  EXPECT_THAT(
+      sketch->value_functions(),
+      ElementsAre(AllOf(Field(&ValueFunction::name, "Frequency"),
+                        Field(&ValueFunction::aggregator_type,
+                              AggregatorType::kSum)),
+                  AllOf(Field(&ValueFunction::name, "Count"),
+                        Field(&ValueFunction::aggregator_type,
+                              AggregatorType::kUnique))));
+
+  ASSERT_THAT(sketch->Insert("a", {{"frequency", 2}}), IsOk());
+  ASSERT_THAT(sketch->Insert("a", {{"frequency", 3}}), IsOk());
+  ASSERT_EQ(sketch->num_registers(), 1);
+  const AnySketch::Register reg = *sketch->begin();
+  EXPECT_EQ(reg.index,
+            GetSaltedFingerprinter("index").Fingerprint("a") % 1000);
+  EXPECT_THAT(reg.values, ElementsAre(5, 1));
+}
+
+TEST(SketchConfigTest, CreateAnySketchFromConfigWithoutAggregatorFails) {
+  SketchConfig config = ParseTextProto<SketchConfig>(R"pb(
+    values { distribution { constant { value: 1 } } }
+  )pb");
+
+  EXPECT_THAT(CreateAnySketchFromConfig(config), IsNotOk());
+}
+
+TEST(SketchConfigTest, SaltedFingerprintersAreSharedPerSalt) {
+  const DerivedFingerprinter& fingerprinter = GetSaltedFingerprinter("salt");
+
+  EXPECT_EQ(&GetSaltedFingerprinter("salt"), &fingerprinter);
+  EXPECT_NE(&GetSaltedFingerprinter("other salt"), &fingerprinter);
+  EXPECT_EQ(fingerprinter.base(), &GetFarmFingerprinter());
+  EXPECT_EQ(fingerprinter.Fingerprint("item"),
+            fingerprinter.Derive(GetFarmFingerprinter().Fingerprint("item")));
+  EXPECT_NE(GetSaltedFingerprinter("other salt").Fingerprint("item"),
+            fingerprinter.Fingerprint("item"));
+}
+
+}  // namespace
+}  // namespace wfa::any_sketch
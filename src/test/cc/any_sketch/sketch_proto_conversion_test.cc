@@ -0,0 +1,161 @@
+// Copyright 2026 The Cross-Media Measurement Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "any_sketch/sketch_proto_conversion.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "any_sketch/aggregators.h"
+#include "any_sketch/any_sketch.h"
+#include "any_sketch/distributions.h"
+#include "any_sketch/value_function.h"
+#include "common_cpp/fingerprinters/fingerprinters.h"
+#include "common_cpp/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "gtest/gtest.h"
+#include "wfa/any_sketch/sketch.pb.h"
+
+namespace wfa::any_sketch {
+namespace {
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+std::unique_ptr<AnySketch> MakeSketch(const AnySketchOptions& options) {
+  std::vector<std::unique_ptr<BaseDistribution>> indexes;
+  indexes.push_back(GetUniformDistribution(&GetFarmFingerprinter(), 0, 99));
+  std::vector<ValueFunction> values;
+  values.push_back(
+      {.name = "Frequency",
+       .aggregator_type = AggregatorType::kSum,
+       .distribution = GetOracleDistribution("frequency", -10, 10)});
+  values.push_back({.name = "Key",
+                    .aggregator_type = AggregatorType::kUnique,
+                    .distribution = GetOracleDistribution("key", 0, 10)});
+  return absl::make_unique<AnySketch>(std::move(indexes), std::move(values),
+                                      options);
+}
+
+// Returns a sketch with registers 0, 7 and 42, which includes a negative sum
+// and a destroyed unique value.
+std::unique_ptr<AnySketch> MakeFilledSketch(const AnySketchOptions& options) {
+  std::unique_ptr<AnySketch> sketch = MakeSketch(options);
+  EXPECT_THAT(sketch->AggregateIntoRegister(42, {3, 5}), IsOk());
+  EXPECT_THAT(sketch->AggregateIntoRegister(0, {-7, 2}), IsOk());
+  EXPECT_THAT(sketch->AggregateIntoRegister(7, {1, 1}), IsOk());
+  EXPECT_THAT(sketch->AggregateIntoRegister(42, {1, 6}), IsOk());
+  return sketch;
+}
+
+class SketchProtoConversionTest
+    : public ::testing::TestWithParam<uint64_t /* max_dense_index_space */> {
+ protected:
+  AnySketchOptions options() const {
+    return {.max_dense_index_space = GetParam()};
+  }
+};
+
+TEST_P(SketchProtoConversionTest, ToProtoEncodesValues) {
+  std::unique_ptr<AnySketch> sketch = MakeFilledSketch(options());
+
+  Sketch sketch_proto;
+  ToProto(*sketch, &sketch_proto);
+
+  // Unique values are stored shifted by one, so that destroyed is 0.
+  std::vector<std::pair<int64_t, std::vector<int64_t>>> registers;
+  for (const Sketch::Register& register_proto : sketch_proto.registers()) {
+    registers.emplace_back(
+        register_proto.index(),
+        std::vector<int64_t>(register_proto.values().begin(),
+                             register_proto.values().end()));
+  }
+  std::sort(registers.begin(), registers.end());
+  EXPECT_THAT(registers, ElementsAre(Pair(0, ElementsAre(-7, 3)),
+                                     Pair(7, ElementsAre(1, 2)),
+                                     Pair(42, ElementsAre(4, 0))));
+}
+
+TEST_P(SketchProtoConversionTest, ToProtoReplacesRegistersOnArena) {
+  std::unique_ptr<AnySketch> sketch = MakeFilledSketch(options());
+  google::protobuf::Arena arena;
+  Sketch* sketch_proto = google::protobuf::Arena::Create<Sketch>(&arena);
+  sketch_proto->add_registers()->set_index(99);
+
+  ToProto(*sketch, sketch_proto);
+
+  ASSERT_EQ(sketch_proto->registers_size(), 3);
+  for (const Sketch::Register& register_proto : sketch_proto->registers()) {
+    EXPECT_NE(register_proto.index(), 99);
+    EXPECT_EQ(register_proto.GetArena(), &arena);
+  }
+}
+
+TEST_P(SketchProtoConversionTest, FromProtoRestoresRegisters) {
+  std::unique_ptr<AnySketch> sketch = MakeFilledSketch(options());
+  Sketch sketch_proto;
+  ToProto(*sketch, &sketch_proto);
+
+  std::unique_ptr<AnySketch> restored = MakeSketch(options());
+  ASSERT_THAT(FromProto(sketch_proto, restored.get()), IsOk());
+
+  Sketch restored_proto;
+  ToProto(*restored, &restored_proto);
+  EXPECT_EQ(restored_proto.SerializeAsString(),
+            sketch_proto.SerializeAsString());
+}
+
+TEST_P(SketchProtoConversionTest, FromProtoWithWrongNumberOfValuesFails) {
+  Sketch sketch_proto;
+  Sketch::Register* register_proto = sketch_proto.add_registers();
+  register_proto->set_index(1);
+  register_proto->add_values(1);
+
+  std::unique_ptr<AnySketch> sketch = MakeSketch(options());
+  EXPECT_THAT(FromProto(sketch_proto, sketch.get()), IsNotOk());
+}
+
+TEST_P(SketchProtoConversionTest, WriteSketchProtoMatchesSerializedProto) {
+  std::unique_ptr<AnySketch> sketch = MakeFilledSketch(options());
+  Sketch sketch_proto;
+  ToProto(*sketch, &sketch_proto);
+
+  std::string output;
+  {
+    google::protobuf::io::StringOutputStream stream(&output);
+    ASSERT_THAT(WriteSketchProto(*sketch, &stream), IsOk());
+  }
+
+  EXPECT_EQ(output, sketch_proto.SerializeAsString());
+}
+
+TEST_P(SketchProtoConversionTest, WriteSketchProtoToFullOutputFails) {
+  std::unique_ptr<AnySketch> sketch = MakeFilledSketch(options());
+  char buffer[4];
+  google::protobuf::io::ArrayOutputStream stream(buffer, sizeof(buffer));
+
+  EXPECT_THAT(WriteSketchProto(*sketch, &stream), IsNotOk());
+}
+
+INSTANTIATE_TEST_SUITE_P(DenseAndSparse, SketchProtoConversionTest,
+                         ::testing::Values(100, 0));
+
+}  // namespace
+}  // namespace wfa::any_sketch